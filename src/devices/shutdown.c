@@ -5,6 +5,9 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -13,6 +16,9 @@
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/swap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -20,6 +26,9 @@
 /* How to shut down when shutdown() is called. */
 static enum shutdown_type how = SHUTDOWN_NONE;
 
+/* Print memory allocator statistics too? */
+static bool show_memory_stats;
+
 static void print_stats (void);
 
 /* Shuts down the machine in the way configured by
@@ -52,6 +61,14 @@ shutdown_configure (enum shutdown_type type)
   how = type;
 }
 
+/* Makes the statistics printed at power off include those of
+   the page, malloc() and slab allocators. */
+void
+shutdown_show_memory_stats (void)
+{
+  show_memory_stats = true;
+}
+
 /* Reboots the machine via the keyboard controller. */
 void
 shutdown_reboot (void)
@@ -122,6 +139,12 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  if (show_memory_stats)
+    {
+      palloc_print_stats ();
+      malloc_print_stats ();
+      slab_print_stats ();
+    }
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -130,4 +153,7 @@ print_stats (void)
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  swap_print_stats ();
+#endif
 }
@@ -13,6 +13,7 @@ enum shutdown_type
 
 void shutdown (void);
 void shutdown_configure (enum shutdown_type);
+void shutdown_show_memory_stats (void);
 void shutdown_reboot (void) NO_RETURN;
 void shutdown_power_off (void) NO_RETURN;
 
@@ -68,6 +68,36 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+   Looks at a whole element at a time: bits of the wrong value
+   are skipped a word at a time, and the first bit of the right
+   value in a word is found with a single bsf instruction. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+  size_t idx = elem_idx (start);
+  size_t end_idx;
+  elem_type bits;
+
+  if (start >= end)
+    return end;
+  end_idx = elem_idx (end - 1);
+
+  /* Bits set to VALUE become 1s in BITS.  Drop those below START. */
+  bits = (b->bits[idx] ^ flip) & ~(bit_mask (start) - 1);
+  while (bits == 0)
+    {
+      if (++idx > end_idx)
+        return end;
+      bits = b->bits[idx] ^ flip;
+    }
+
+  start = idx * ELEM_BITS + __builtin_ctzl (bits);
+  return start < end ? start : end;
+}
 
 /* Creation and destruction. */
 
@@ -251,16 +281,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -299,13 +324,27 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 0)
+    return start;
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+
+      /* Jump from the start of each run of VALUE bits to the bit
+         that ends it, looking no further than CNT bits ahead. */
+      while (i <= last)
+        {
+          size_t end;
+
+          i = find_bit (b, i, last + 1, value);
+          if (i > last)
+            break;
+          end = find_bit (b, i, i + cnt, !value);
+          if (end == i + cnt)
+            return i;
+          i = end + 1;
+        }
     }
   return BITMAP_ERROR;
 }
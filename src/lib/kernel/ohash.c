@@ -0,0 +1,424 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Number of slots allocated by the first insertion. */
+#define MIN_SLOTS 16
+
+/* Number of old slots migrated by each insertion or deletion
+   while the table is growing.  Migrating an array of N slots
+   takes at most N steps past empty slots plus 3N/4 element
+   moves, and the new array of 2N slots takes at least 3N/4
+   insertions to fill to 3/4, so anything above 7/3 finishes in
+   time. */
+#define MIGRATE_STEPS 4
+
+static unsigned elem_hash (const struct ohash *, const void *elem);
+static unsigned int_hash (uintptr_t key);
+static size_t probe_dist (const struct ohash_slot *, size_t slot_cnt,
+                          size_t idx);
+static void *lookup (const struct ohash *, const struct ohash_slot *,
+                     size_t slot_cnt, unsigned hash,
+                     const void *probe, uintptr_t key);
+static size_t find_slot (struct ohash_slot *, size_t slot_cnt,
+                         unsigned hash, void *elem);
+static void place (struct ohash_slot *, size_t slot_cnt,
+                   unsigned hash, void *elem);
+static void remove_slot (struct ohash_slot *, size_t slot_cnt, size_t idx);
+static void migrate (struct ohash *, size_t steps);
+static bool grow (struct ohash *);
+
+/* Initializes generic hash table H to compute hash values using
+   HASH and compare elements using EQUAL, given auxiliary data
+   AUX.  No memory is allocated until the first insertion. */
+void
+ohash_init (struct ohash *h,
+            ohash_hash_func *hash, ohash_equal_func *equal, void *aux)
+{
+  ASSERT (hash != NULL && equal != NULL);
+
+  ohash_init_int (h, 0);
+  h->hash = hash;
+  h->equal = equal;
+  h->aux = aux;
+}
+
+/* Initializes hash table H to be keyed by the uintptr_t-sized
+   word KEY_OFS bytes into each element, e.g. as given by
+   offsetof (struct page, address).  No memory is allocated
+   until the first insertion. */
+void
+ohash_init_int (struct ohash *h, size_t key_ofs)
+{
+  h->elem_cnt = 0;
+  h->slot_cnt = 0;
+  h->slots = NULL;
+  h->old_elem_cnt = 0;
+  h->old_slot_cnt = 0;
+  h->old_slots = NULL;
+  h->migrate_idx = 0;
+  h->key_ofs = key_ofs;
+  h->hash = NULL;
+  h->equal = NULL;
+  h->aux = NULL;
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the table.  DESTRUCTOR may, if appropriate, deallocate the
+   element.  However, modifying H while ohash_clear() is running
+   yields undefined behavior. */
+void
+ohash_clear (struct ohash *h, ohash_action_func *destructor)
+{
+  size_t i;
+
+  for (i = 0; i < h->slot_cnt; i++)
+    {
+      struct ohash_slot *s = &h->slots[i];
+      if (s->elem != NULL && destructor != NULL)
+        destructor (s->elem, h->aux);
+      s->elem = NULL;
+    }
+  for (i = 0; i < h->old_slot_cnt; i++)
+    {
+      struct ohash_slot *s = &h->old_slots[i];
+      if (s->elem != NULL && destructor != NULL)
+        destructor (s->elem, h->aux);
+    }
+  free (h->old_slots);
+  h->old_slots = NULL;
+  h->old_slot_cnt = 0;
+  h->old_elem_cnt = 0;
+  h->elem_cnt = 0;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the table, as in ohash_clear(). */
+void
+ohash_destroy (struct ohash *h, ohash_action_func *destructor)
+{
+  ohash_clear (h, destructor);
+  free (h->slots);
+  h->slots = NULL;
+  h->slot_cnt = 0;
+}
+
+/* Inserts ELEM into H.  No element equal to ELEM may already be
+   in the table.  Returns true if successful, false if the table
+   is full and memory to grow it could not be allocated. */
+bool
+ohash_insert (struct ohash *h, void *elem)
+{
+  size_t new_cnt;
+
+  ASSERT (elem != NULL);
+
+  migrate (h, MIGRATE_STEPS);
+
+  /* Grow at 3/4 load.  If that fails, carry on filling the
+     remaining slots; only a completely full table refuses. */
+  new_cnt = h->elem_cnt - h->old_elem_cnt;
+  if ((new_cnt + 1) * 4 > h->slot_cnt * 3
+      && !grow (h) && h->elem_cnt == h->slot_cnt)
+    return false;
+
+  place (h->slots, h->slot_cnt, elem_hash (h, elem), elem);
+  h->elem_cnt++;
+  return true;
+}
+
+/* Finds and returns an element equal to PROBE in generic hash
+   table H, or a null pointer if none exists. */
+void *
+ohash_find (const struct ohash *h, const void *probe)
+{
+  unsigned hash;
+  void *found;
+
+  ASSERT (h->hash != NULL);
+  hash = h->hash (probe, h->aux);
+  found = lookup (h, h->slots, h->slot_cnt, hash, probe, 0);
+  if (found == NULL && h->old_elem_cnt > 0)
+    found = lookup (h, h->old_slots, h->old_slot_cnt, hash, probe, 0);
+  return found;
+}
+
+/* Finds and returns the element with key KEY in integer-keyed
+   hash table H, or a null pointer if none exists. */
+void *
+ohash_find_int (const struct ohash *h, uintptr_t key)
+{
+  unsigned hash = int_hash (key);
+  void *found;
+
+  ASSERT (h->hash == NULL);
+  found = lookup (h, h->slots, h->slot_cnt, hash, NULL, key);
+  if (found == NULL && h->old_elem_cnt > 0)
+    found = lookup (h, h->old_slots, h->old_slot_cnt, hash, NULL, key);
+  return found;
+}
+
+/* Removes ELEM itself from H.  Returns true if ELEM was in the
+   table, false otherwise. */
+bool
+ohash_delete (struct ohash *h, void *elem)
+{
+  unsigned hash;
+  size_t idx;
+
+  if (h->elem_cnt == 0)
+    return false;
+
+  hash = elem_hash (h, elem);
+  idx = find_slot (h->slots, h->slot_cnt, hash, elem);
+  if (idx != SIZE_MAX)
+    remove_slot (h->slots, h->slot_cnt, idx);
+  else if (h->old_elem_cnt > 0
+           && (idx = find_slot (h->old_slots, h->old_slot_cnt,
+                                hash, elem)) != SIZE_MAX)
+    {
+      remove_slot (h->old_slots, h->old_slot_cnt, idx);
+      h->old_elem_cnt--;
+    }
+  else
+    return false;
+  h->elem_cnt--;
+
+  migrate (h, MIGRATE_STEPS);
+  return true;
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (const struct ohash *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+ohash_empty (const struct ohash *h)
+{
+  return h->elem_cnt == 0;
+}
+
+/* Returns the hash value of ELEM in H. */
+static unsigned
+elem_hash (const struct ohash *h, const void *elem)
+{
+  if (h->hash != NULL)
+    return h->hash (elem, h->aux);
+  return int_hash (*(const uintptr_t *) ((const char *) elem + h->key_ofs));
+}
+
+/* Returns a hash value for integer KEY.
+
+   Keys are often page addresses, whose low bits are all zero, so
+   the high bits of the product are folded back into the low bits
+   that select the home slot. */
+static unsigned
+int_hash (uintptr_t key)
+{
+  unsigned hash = (unsigned) key * 2654435769u;
+  return hash ^ (hash >> 16);
+}
+
+/* Returns how far the element in occupied slot IDX of SLOTS, an
+   array of SLOT_CNT slots, is from its home slot. */
+static size_t
+probe_dist (const struct ohash_slot *slots, size_t slot_cnt, size_t idx)
+{
+  return (idx - slots[idx].hash) & (slot_cnt - 1);
+}
+
+/* Searches SLOTS, an array of SLOT_CNT slots in H, for an
+   element with hash value HASH that is equal to PROBE, in a
+   generic table, or has key KEY, in an integer-keyed table.
+   Returns it if found or a null pointer otherwise. */
+static void *
+lookup (const struct ohash *h, const struct ohash_slot *slots,
+        size_t slot_cnt, unsigned hash, const void *probe, uintptr_t key)
+{
+  size_t mask = slot_cnt - 1;
+  size_t idx, dist;
+
+  if (slot_cnt == 0)
+    return NULL;
+
+  idx = hash & mask;
+  for (dist = 0; ; dist++)
+    {
+      const struct ohash_slot *s = &slots[idx];
+
+      /* Robin Hood order means an element with our hash would
+         have displaced any element closer to its home. */
+      if (s->elem == NULL || probe_dist (slots, slot_cnt, idx) < dist)
+        return NULL;
+      if (s->hash == hash)
+        {
+          if (h->hash == NULL
+              ? *(const uintptr_t *) ((const char *) s->elem
+                                      + h->key_ofs) == key
+              : h->equal (s->elem, probe, h->aux))
+            return s->elem;
+        }
+      idx = (idx + 1) & mask;
+    }
+}
+
+/* Returns the index of the slot holding ELEM, with hash value
+   HASH, in SLOTS, an array of SLOT_CNT slots, or SIZE_MAX if
+   ELEM is not there. */
+static size_t
+find_slot (struct ohash_slot *slots, size_t slot_cnt,
+           unsigned hash, void *elem)
+{
+  size_t mask = slot_cnt - 1;
+  size_t idx, dist;
+
+  if (slot_cnt == 0)
+    return SIZE_MAX;
+
+  idx = hash & mask;
+  for (dist = 0; slots[idx].elem != elem; dist++)
+    {
+      if (slots[idx].elem == NULL
+          || probe_dist (slots, slot_cnt, idx) < dist)
+        return SIZE_MAX;
+      idx = (idx + 1) & mask;
+    }
+  return idx;
+}
+
+/* Stores ELEM, with hash value HASH, in SLOTS, an array of
+   SLOT_CNT slots that must have a free slot. */
+static void
+place (struct ohash_slot *slots, size_t slot_cnt,
+       unsigned hash, void *elem)
+{
+  size_t mask = slot_cnt - 1;
+  size_t idx = hash & mask;
+  size_t dist;
+
+  for (dist = 0; ; dist++)
+    {
+      struct ohash_slot *s = &slots[idx];
+      size_t s_dist;
+
+      if (s->elem == NULL)
+        {
+          s->hash = hash;
+          s->elem = elem;
+          return;
+        }
+
+      /* Take the slot from an element closer to its home, and
+         carry on placing that element instead. */
+      s_dist = probe_dist (slots, slot_cnt, idx);
+      if (s_dist < dist)
+        {
+          unsigned s_hash = s->hash;
+          void *s_elem = s->elem;
+
+          s->hash = hash;
+          s->elem = elem;
+          hash = s_hash;
+          elem = s_elem;
+          dist = s_dist;
+        }
+      idx = (idx + 1) & mask;
+    }
+}
+
+/* Empties slot IDX of SLOTS, an array of SLOT_CNT slots.  The
+   elements that follow it in its probe sequence are moved back
+   by one slot, so no tombstones are left behind. */
+static void
+remove_slot (struct ohash_slot *slots, size_t slot_cnt, size_t idx)
+{
+  size_t mask = slot_cnt - 1;
+
+  for (;;)
+    {
+      size_t next = (idx + 1) & mask;
+      if (slots[next].elem == NULL
+          || probe_dist (slots, slot_cnt, next) == 0)
+        break;
+      slots[idx] = slots[next];
+      idx = next;
+    }
+  slots[idx].elem = NULL;
+}
+
+/* Moves up to STEPS elements of H from the old slot array to the
+   new one, or skips past empty old slots, counting each skipped
+   slot as a step.  Frees the old array once it is empty.
+
+   Elements are taken from the lowest nonempty old slot, and
+   removing one only ever shifts later elements back into it, so
+   the slots below MIGRATE_IDX stay empty. */
+static void
+migrate (struct ohash *h, size_t steps)
+{
+  for (; h->old_slots != NULL && steps > 0; steps--)
+    {
+      struct ohash_slot *s;
+
+      if (h->old_elem_cnt == 0)
+        {
+          free (h->old_slots);
+          h->old_slots = NULL;
+          h->old_slot_cnt = 0;
+          break;
+        }
+
+      s = &h->old_slots[h->migrate_idx];
+      if (s->elem != NULL)
+        {
+          place (h->slots, h->slot_cnt, s->hash, s->elem);
+          remove_slot (h->old_slots, h->old_slot_cnt, h->migrate_idx);
+          h->old_elem_cnt--;
+        }
+      else
+        h->migrate_idx++;
+    }
+}
+
+/* Doubles the number of slots in H.  The elements are migrated
+   to the new slots a few at a time by later insertions and
+   deletions.  Returns true if successful, false if out of
+   memory, in which case H is unchanged. */
+static bool
+grow (struct ohash *h)
+{
+  size_t new_cnt = h->slot_cnt > 0 ? h->slot_cnt * 2 : MIN_SLOTS;
+  struct ohash_slot *new_slots;
+
+  /* MIGRATE_STEPS should make this a no-op. */
+  migrate (h, SIZE_MAX);
+
+  new_slots = calloc (new_cnt, sizeof *new_slots);
+  if (new_slots == NULL)
+    return false;
+
+  if (h->elem_cnt > 0)
+    {
+      h->old_slots = h->slots;
+      h->old_slot_cnt = h->slot_cnt;
+      h->old_elem_cnt = h->elem_cnt;
+      h->migrate_idx = 0;
+    }
+  else
+    free (h->slots);
+  h->slots = new_slots;
+  h->slot_cnt = new_cnt;
+  return true;
+}
@@ -0,0 +1,98 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+
+   Unlike struct hash, which chains elements through lists, this
+   table keeps a single array of slots, each holding a pointer to
+   an element and that element's hash value.  A lookup usually
+   touches one or two adjacent slots and only looks at an element
+   whose stored hash matches, so it costs about one cache miss
+   instead of one per element in a chain.
+
+   Collisions are resolved by linear probing with Robin Hood
+   ordering: an element that is further from its home slot takes
+   the place of one that is closer.  This keeps probe sequences
+   short and lets a lookup stop as soon as it meets an element
+   closer to home than the key it is looking for.  Deletion
+   shifts the following elements back rather than leaving
+   tombstones.
+
+   The table doubles when it becomes 3/4 full.  Rather than
+   moving every element at once, which would make an unlucky
+   insertion cost O(n), the old slot array is kept and a few of
+   its slots are migrated to the new one by each insertion and
+   deletion.  Until the migration finishes, lookups consult both
+   arrays.  Migration is fast enough to finish well before the
+   new array fills up in turn.
+
+   Elements are owned by the caller and need no embedded member.
+   A table is either integer-keyed or generic:
+
+   - An integer-keyed table (ohash_init_int()) reads each
+     element's key from a uintptr_t-sized word at a fixed offset
+     in the element, such as a page address.  Hashing and
+     comparison are done inline, without callbacks.  Look up
+     elements with ohash_find_int().
+
+   - A generic table (ohash_init()) uses caller-supplied hash
+     and equality functions.  Look up elements with ohash_find(),
+     passing an element with the same key. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Computes and returns the hash value for element E, given
+   auxiliary data AUX. */
+typedef unsigned ohash_hash_func (const void *e, void *aux);
+
+/* Returns true if elements A and B have the same key, given
+   auxiliary data AUX. */
+typedef bool ohash_equal_func (const void *a, const void *b, void *aux);
+
+/* Performs some operation on element E, given auxiliary data
+   AUX. */
+typedef void ohash_action_func (void *e, void *aux);
+
+/* A slot in the table.  ELEM is null if the slot is empty. */
+struct ohash_slot
+  {
+    unsigned hash;              /* Hash value of ELEM. */
+    void *elem;                 /* Element, or a null pointer. */
+  };
+
+/* Open-addressing hash table. */
+struct ohash
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    size_t slot_cnt;            /* Number of slots, 0 or a power of 2. */
+    struct ohash_slot *slots;   /* Array of SLOT_CNT slots. */
+    size_t old_elem_cnt;        /* Elements still in OLD_SLOTS. */
+    size_t old_slot_cnt;        /* Number of slots in OLD_SLOTS. */
+    struct ohash_slot *old_slots; /* Array being migrated, or null. */
+    size_t migrate_idx;         /* OLD_SLOTS below this are empty. */
+    size_t key_ofs;             /* Offset of the key, if integer-keyed. */
+    ohash_hash_func *hash;      /* Hash function, if generic. */
+    ohash_equal_func *equal;    /* Comparison function, if generic. */
+    void *aux;                  /* Auxiliary data for HASH and EQUAL. */
+  };
+
+/* Basic life cycle. */
+void ohash_init (struct ohash *, ohash_hash_func *, ohash_equal_func *,
+                 void *aux);
+void ohash_init_int (struct ohash *, size_t key_ofs);
+void ohash_clear (struct ohash *, ohash_action_func *);
+void ohash_destroy (struct ohash *, ohash_action_func *);
+
+/* Search, insertion, deletion. */
+bool ohash_insert (struct ohash *, void *);
+void *ohash_find (const struct ohash *, const void *);
+void *ohash_find_int (const struct ohash *, uintptr_t key);
+bool ohash_delete (struct ohash *, void *);
+
+/* Information. */
+size_t ohash_size (const struct ohash *);
+bool ohash_empty (const struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
@@ -1,5 +1,22 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* Blocks shorter than this are handled a byte at a time.  Longer
+   ones are handled a word at a time, with bytes only for the
+   unaligned head and tail. */
+#define WORD_MIN 16
+
+/* A word that may be used to access memory of any type. */
+typedef uint32_t any_word __attribute__ ((may_alias));
+
+/* Returns the number of bytes from P up to the next word
+   boundary. */
+static inline size_t
+word_head (const void *p)
+{
+  return -(uintptr_t) p & (sizeof (any_word) - 1);
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +29,21 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= WORD_MIN)
+    {
+      /* Align DST, then copy whole words.  SRC may still be
+         unaligned, which costs the CPU a little but is correct. */
+      size_t head = word_head (dst);
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = *src++;
+      words = size / sizeof (any_word);
+      size %= sizeof (any_word);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+    }
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -29,20 +61,41 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
+  if (dst < src || dst >= src + size)
     {
-      while (size-- > 0)
-        *dst++ = *src++;
+      /* Copying upward never overwrites source bytes that are
+         still to be read. */
+      memcpy (dst, src, size);
     }
   else 
     {
       dst += size;
       src += size;
+      if (size >= WORD_MIN)
+        {
+          /* Align the end of DST, then copy whole words downward,
+             starting with the last one. */
+          size_t tail = (uintptr_t) dst & (sizeof (any_word) - 1);
+          size_t words;
+
+          size -= tail;
+          while (tail-- > 0)
+            *--dst = *--src;
+          words = size / sizeof (any_word);
+          size %= sizeof (any_word);
+          dst -= sizeof (any_word);
+          src -= sizeof (any_word);
+          asm volatile ("std; rep movsl; cld"
+                        : "+D" (dst), "+S" (src), "+c" (words)
+                        : : "memory");
+          dst += sizeof (any_word);
+          src += sizeof (any_word);
+        }
       while (size-- > 0)
         *--dst = *--src;
     }
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +111,24 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  if (size >= WORD_MIN && word_head (a) == word_head (b))
+    {
+      size_t head = word_head (a);
+
+      for (; head > 0; head--, size--, a++, b++)
+        if (*a != *b)
+          return *a > *b ? +1 : -1;
+
+      /* Skip equal words.  A differing word is compared a byte at
+         a time below, to find which byte differs. */
+      while (size >= sizeof (any_word)
+             && *(const any_word *) a == *(const any_word *) b)
+        {
+          a += sizeof (any_word);
+          b += sizeof (any_word);
+          size -= sizeof (any_word);
+        }
+    }
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -274,7 +345,11 @@ strtok_r (char *s, const char *delimiters, char **save_ptr)
   return token;
 }
 
-/* Sets the SIZE bytes in DST to VALUE. */
+/* Sets the SIZE bytes in DST to VALUE.
+
+   Whole pages, and any other word-aligned blocks whose size is a
+   multiple of the word size, go straight to "rep stosl" without
+   any byte stores. */
 void *
 memset (void *dst_, int value, size_t size) 
 {
@@ -282,6 +357,20 @@ memset (void *dst_, int value, size_t size)
 
   ASSERT (dst != NULL || size == 0);
   
+  if (size >= WORD_MIN)
+    {
+      any_word word = (unsigned char) value * 0x01010101u;
+      size_t head = word_head (dst);
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = value;
+      words = size / sizeof (any_word);
+      size %= sizeof (any_word);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words) : "a" (word) : "memory");
+    }
   while (size-- > 0)
     *dst++ = value;
 
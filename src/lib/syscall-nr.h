@@ -28,7 +28,84 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extended I/O. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write several buffers to a file. */
+    SYS_PREAD,                  /* Read from a given offset in a file. */
+    SYS_PWRITE,                 /* Write at a given offset in a file. */
+    SYS_IO_SUBMIT,              /* Submit the operations queued in a ring. */
+
+    /* Extended process control. */
+    SYS_SPAWN,                  /* Start another process without waiting. */
+
+    /* Diagnostics. */
+    SYS_MEMSTAT                 /* Report memory usage of this process. */
+  };
+
+/* One buffer of a SYS_READV or SYS_WRITEV request. */
+struct iovec
+  {
+    void *iov_base;             /* Start of the buffer. */
+    unsigned iov_len;           /* Length of the buffer in bytes. */
+  };
+
+/* Maximum number of buffers in one SYS_READV or SYS_WRITEV. */
+#define IOV_MAX 16
+
+/* Operations that can be queued in a struct io_ring. */
+enum io_op
+  {
+    IO_READ,                    /* Like read(fd, buf, len). */
+    IO_WRITE,                   /* Like write(fd, buf, len). */
+    IO_OPEN,                    /* Like open(buf). */
+    IO_CLOSE                    /* Like close(fd). */
+  };
+
+/* Submission queue entry. */
+struct io_sqe
+  {
+    int op;                     /* One of enum io_op. */
+    int fd;                     /* File descriptor, for all but IO_OPEN. */
+    void *buf;                  /* Buffer, or file name for IO_OPEN. */
+    unsigned len;               /* Length of buf in bytes. */
+    unsigned user_data;         /* Copied to the completion as is. */
+  };
+
+/* Completion queue entry. */
+struct io_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* What the equivalent system call returned. */
+  };
+
+/* Number of entries in each queue of a struct io_ring. */
+#define IO_RING_SIZE 64
+
+/* Submission and completion queues shared between a process and the
+   kernel, for SYS_IO_SUBMIT.  The indices run freely and are reduced
+   modulo IO_RING_SIZE to find an entry.  The process fills sq[] and
+   advances sq_tail, the kernel consumes from sq_head; the kernel fills
+   cq[] and advances cq_tail, the process consumes from cq_head. */
+struct io_ring
+  {
+    unsigned sq_head;           /* Next submission the kernel will take. */
+    unsigned sq_tail;           /* Next free submission slot. */
+    unsigned cq_head;           /* Next completion the process will take. */
+    unsigned cq_tail;           /* Next free completion slot. */
+    struct io_sqe sq[IO_RING_SIZE];
+    struct io_cqe cq[IO_RING_SIZE];
+  };
+
+/* Memory usage of a process, filled in by SYS_MEMSTAT.
+   A sample window is half a second of timer ticks. */
+struct memstat
+  {
+    unsigned resident;          /* Frames currently held. */
+    unsigned working_set;       /* Frames referenced in the last window. */
+    unsigned faults;            /* Pages brought into frames in total. */
+    unsigned fault_rate;        /* Pages brought in during the last window. */
   };
 
 #endif /* lib/syscall-nr.h */
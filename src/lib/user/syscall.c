@@ -1,31 +1,51 @@
 #include <syscall.h>
 #include "../syscall-nr.h"
 
+/* Nonzero if the CPU has SYSENTER, in which case the kernel has
+   set it up as a way into the system call handler.  Set by
+   syscall_probe() before main() runs. */
+static int syscall_fast;
+
+/* Enters the kernel for the system call whose number and
+   arguments have been pushed on the stack, with SYSENTER if
+   possible, otherwise through the int $0x30 gate.  SYSENTER
+   takes the stack pointer to return with in %ecx and the address
+   to return to in %edx, so the syscallN() macros below declare
+   both clobbered. */
+#define SYSCALL_TRAP                                            \
+        "cmpl $0, %[fast]; je 1f; "                             \
+        "movl %%esp, %%ecx; movl $2f, %%edx; sysenter; "        \
+        "1: int $0x30; 2: "
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $4, %%esp"                                   \
                : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : [number] "i" (NUMBER),                         \
+                 [fast] "m" (syscall_fast)                      \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+#define syscall1(NUMBER, ARG0)                                  \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg0]; pushl %[number]; " SYSCALL_TRAP    \
+             "addl $8, %%esp"                                   \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [fast] "m" (syscall_fast)                      \
+               : "ecx", "edx", "cc", "memory");                 \
+          retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
@@ -35,12 +55,14 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $12, %%esp"                                  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
-                 [arg1] "g" (ARG1)                              \
-               : "memory");                                     \
+                 [arg1] "g" (ARG1),                             \
+                 [fast] "m" (syscall_fast)                      \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
@@ -51,16 +73,52 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $16, %%esp"                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [arg1] "g" (ARG1),                             \
+                 [arg2] "g" (ARG2),                             \
+                 [fast] "m" (syscall_fast)                      \
+               : "ecx", "edx", "cc", "memory");                 \
+          retval;                                               \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; " SYSCALL_TRAP    \
+             "addl $20, %%esp"                                  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
                  [arg1] "g" (ARG1),                             \
-                 [arg2] "g" (ARG2)                              \
-               : "memory");                                     \
+                 [arg2] "g" (ARG2),                             \
+                 [arg3] "g" (ARG3),                             \
+                 [fast] "m" (syscall_fast)                      \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
+/* CPUID leaf 1 EDX bit for SYSENTER and SYSEXIT. */
+#define CPUID_SEP 0x00000800
+
+/* Decides whether system calls may use SYSENTER, by making the
+   same CPUID check as the kernel. */
+void
+syscall_probe (void)
+{
+  unsigned eax = 1, ebx, ecx, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  syscall_fast = (edx & CPUID_SEP) != 0;
+}
+
 void
 halt (void) 
 {
@@ -182,3 +240,45 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+io_submit (struct io_ring *ring)
+{
+  return syscall1 (SYS_IO_SUBMIT, ring);
+}
+
+pid_t
+spawn (const char *file)
+{
+  return (pid_t) syscall1 (SYS_SPAWN, file);
+}
+
+bool
+memstat (struct memstat *stat)
+{
+  return syscall1 (SYS_MEMSTAT, stat);
+}
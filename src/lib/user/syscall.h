@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include "../syscall-nr.h"
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +46,20 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extended I/O. */
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int io_submit (struct io_ring *);
+
+/* Extended process control. */
+pid_t spawn (const char *file);
+
+/* Diagnostics. */
+bool memstat (struct memstat *);
+
+/* Run by _start() before main(). */
+void syscall_probe (void);
+
 #endif /* lib/user/syscall.h */
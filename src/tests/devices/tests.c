@@ -53,6 +53,8 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"palloc-frag", test_palloc_frag},
+    {"palloc-zero", test_palloc_zero},
   };  
 #endif
 
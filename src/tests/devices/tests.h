@@ -37,6 +37,8 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_palloc_frag;
+extern test_func test_palloc_zero;
 #endif
 
 void msg (const char *, ...);
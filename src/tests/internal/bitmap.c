@@ -0,0 +1,94 @@
+/* Benchmark for bitmap_scan() in lib/kernel/bitmap.c.
+
+   Fills a 1M-bit map to several levels at random and times
+   scans for runs of free bits of a few lengths, against a
+   reference scan that tests one bit at a time, the way
+   bitmap_scan() used to.  Checks that both find the same runs.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Number of bits in the map. */
+#define BIT_CNT (1024 * 1024)
+
+/* Scans timed for each fill level and run length. */
+#define SCAN_CNT 16
+
+static size_t reference_scan (const struct bitmap *, size_t start,
+                              size_t cnt);
+
+/* Time bitmap_scan() against the bit-at-a-time reference. */
+void
+test (void) 
+{
+  static const int fill_levels[] = {0, 50, 90, 99};
+  static const size_t run_lengths[] = {1, 8, 64};
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  size_t i, j;
+
+  ASSERT (b != NULL);
+  for (i = 0; i < sizeof fill_levels / sizeof *fill_levels; i++)
+    {
+      int fill = fill_levels[i];
+      size_t k;
+
+      for (k = 0; k < BIT_CNT; k++)
+        bitmap_set (b, k, (int) (random_ulong () % 100) < fill);
+
+      for (j = 0; j < sizeof run_lengths / sizeof *run_lengths; j++)
+        {
+          size_t cnt = run_lengths[j];
+          int64_t start, fast_ticks, slow_ticks;
+          size_t fast = 0, slow = 0;
+          int n;
+
+          start = timer_ticks ();
+          for (n = 0; n < SCAN_CNT; n++)
+            fast = bitmap_scan (b, n * (BIT_CNT / SCAN_CNT / 2), cnt, false);
+          fast_ticks = timer_elapsed (start);
+
+          start = timer_ticks ();
+          for (n = 0; n < SCAN_CNT; n++)
+            slow = reference_scan (b, n * (BIT_CNT / SCAN_CNT / 2), cnt);
+          slow_ticks = timer_elapsed (start);
+
+          ASSERT (fast == slow);
+          printf ("%d%% full, runs of %zu: %"PRId64" ticks, "
+                  "bit at a time %"PRId64" ticks\n",
+                  fill, cnt, fast_ticks, slow_ticks);
+        }
+    }
+  bitmap_destroy (b);
+
+  printf ("bitmap: PASS\n");
+}
+
+/* Returns the first index at or after START where CNT bits in B
+   are all false, or BITMAP_ERROR, testing one bit at a time. */
+static size_t
+reference_scan (const struct bitmap *b, size_t start, size_t cnt) 
+{
+  size_t i;
+
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    {
+      size_t k;
+
+      for (k = 0; k < cnt; k++)
+        if (bitmap_test (b, i + k))
+          break;
+      if (k == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
@@ -0,0 +1,123 @@
+/* Stress test and benchmark for threads/malloc.c.
+
+   Keeps a set of blocks of random sizes, from a few bytes to a
+   few pages, and replaces them in random order, checking that no
+   block is overwritten while it is held.  Then allocates and
+   frees a single block many times over, which used to get and
+   free a whole page each time.  Prints how many timer ticks each
+   phase takes.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Number of blocks held at once. */
+#define SLOT_CNT 256
+
+/* Largest block requested, in bytes. */
+#define MAX_SIZE 6000
+
+/* Operations in the random phase and the ping-pong phase. */
+#define RANDOM_OPS 200000
+#define PING_PONG_OPS 200000
+
+/* A block held by the test. */
+struct slot
+  {
+    uint8_t *block;             /* Block, or a null pointer. */
+    size_t size;                /* Bytes requested. */
+    uint8_t fill;               /* Byte the block was filled with. */
+  };
+
+static size_t random_size (void);
+static void check_slot (const struct slot *);
+
+/* Test malloc() and free() under a random load. */
+void
+test (void) 
+{
+  static struct slot slots[SLOT_CNT];
+  int64_t start;
+  int i;
+
+  printf ("random sizes up to %d bytes:", MAX_SIZE);
+  start = timer_ticks ();
+  for (i = 0; i < RANDOM_OPS; i++)
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+
+      if (s->block != NULL)
+        {
+          check_slot (s);
+          free (s->block);
+          s->block = NULL;
+        }
+      else
+        {
+          s->size = random_size ();
+          s->fill = random_ulong ();
+          s->block = malloc (s->size);
+          ASSERT (s->block != NULL);
+          memset (s->block, s->fill, s->size);
+        }
+    }
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].block != NULL)
+      {
+        check_slot (&slots[i]);
+        free (slots[i].block);
+        slots[i].block = NULL;
+      }
+  printf (" %d operations in %"PRId64" ticks\n",
+          RANDOM_OPS, timer_elapsed (start));
+
+  printf ("one block at a time:");
+  start = timer_ticks ();
+  for (i = 0; i < PING_PONG_OPS; i++)
+    {
+      void *p = malloc (40);
+      ASSERT (p != NULL);
+      free (p);
+    }
+  printf (" %d pairs in %"PRId64" ticks\n",
+          PING_PONG_OPS, timer_elapsed (start));
+
+  printf ("malloc: PASS\n");
+}
+
+/* Returns a random request size, mostly small. */
+static size_t
+random_size (void) 
+{
+  switch (random_ulong () % 4)
+    {
+    case 0:
+    case 1:
+      return random_ulong () % 64 + 1;
+    case 2:
+      return random_ulong () % 1024 + 1;
+    default:
+      return random_ulong () % MAX_SIZE + 1;
+    }
+}
+
+/* Checks that the block held in S still has its contents. */
+static void
+check_slot (const struct slot *s) 
+{
+  size_t i;
+
+  for (i = 0; i < s->size; i++)
+    ASSERT (s->block[i] == s->fill);
+}
@@ -0,0 +1,162 @@
+/* Test and benchmark for memcpy(), memmove(), memset() and
+   memcmp() in lib/string.c.
+
+   Checks each function against a byte-at-a-time reference for
+   every combination of source and destination alignment and for
+   sizes around the point where they switch to whole words.  Then
+   times copying and zeroing pages, against the byte-at-a-time
+   loops they used to be, and prints the throughput.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Size of the buffers used for checking. */
+#define BUF_SIZE 128
+
+/* Page copies or zeroings timed in each benchmark. */
+#define PAGE_OPS 20000
+
+static void check (void);
+static void bench (const char *name, void (*fast) (void *, void *),
+                   void (*slow) (void *, void *));
+static void fast_copy (void *, void *);
+static void slow_copy (void *, void *);
+static void fast_zero (void *, void *);
+static void slow_zero (void *, void *);
+
+/* Check, then time the string functions. */
+void
+test (void)
+{
+  check ();
+  bench ("page copy", fast_copy, slow_copy);
+  bench ("page zero", fast_zero, slow_zero);
+  printf ("string: PASS\n");
+}
+
+/* Compares each function with a reference for all alignments
+   and a range of sizes. */
+static void
+check (void)
+{
+  static uint8_t src[BUF_SIZE], dst[BUF_SIZE], ref[BUF_SIZE];
+  size_t s_ofs, d_ofs, size, i;
+
+  for (s_ofs = 0; s_ofs < 8; s_ofs++)
+    for (d_ofs = 0; d_ofs < 8; d_ofs++)
+      for (size = 0; size <= 64; size++)
+        {
+          for (i = 0; i < BUF_SIZE; i++)
+            {
+              src[i] = random_ulong ();
+              dst[i] = ref[i] = random_ulong ();
+            }
+
+          memcpy (dst + d_ofs, src + s_ofs, size);
+          for (i = 0; i < size; i++)
+            ref[d_ofs + i] = src[s_ofs + i];
+          for (i = 0; i < BUF_SIZE; i++)
+            ASSERT (dst[i] == ref[i]);
+
+          ASSERT (memcmp (dst + d_ofs, src + s_ofs, size) == 0);
+          if (size > 0)
+            {
+              size_t k = random_ulong () % size;
+              dst[d_ofs + k]++;
+              ASSERT ((memcmp (dst + d_ofs, src + s_ofs, size) > 0)
+                      == (dst[d_ofs + k] > src[s_ofs + k]));
+              dst[d_ofs + k]--;
+            }
+
+          memset (dst + d_ofs, s_ofs, size);
+          for (i = 0; i < size; i++)
+            ref[d_ofs + i] = s_ofs;
+          for (i = 0; i < BUF_SIZE; i++)
+            ASSERT (dst[i] == ref[i]);
+
+          /* Overlapping moves in both directions. */
+          memmove (dst + d_ofs, dst + s_ofs, size);
+          for (i = 0; i < size; i++)
+            src[i] = ref[s_ofs + i];
+          for (i = 0; i < size; i++)
+            ref[d_ofs + i] = src[i];
+          for (i = 0; i < BUF_SIZE; i++)
+            ASSERT (dst[i] == ref[i]);
+        }
+}
+
+/* Times PAGE_OPS calls of FAST and of SLOW on a pair of pages
+   and prints the throughput of each as NAME. */
+static void
+bench (const char *name, void (*fast) (void *, void *),
+       void (*slow) (void *, void *))
+{
+  uint8_t *pages = palloc_get_multiple (PAL_ASSERT, 2);
+  int64_t start, fast_ticks, slow_ticks;
+  int i;
+
+  start = timer_ticks ();
+  for (i = 0; i < PAGE_OPS; i++)
+    fast (pages, pages + PGSIZE);
+  fast_ticks = timer_elapsed (start);
+
+  start = timer_ticks ();
+  for (i = 0; i < PAGE_OPS; i++)
+    slow (pages, pages + PGSIZE);
+  slow_ticks = timer_elapsed (start);
+
+  printf ("%s: %"PRId64" kB/s, byte at a time %"PRId64" kB/s\n", name,
+          (int64_t) PAGE_OPS * (PGSIZE / 1024) * TIMER_FREQ
+          / (fast_ticks > 0 ? fast_ticks : 1),
+          (int64_t) PAGE_OPS * (PGSIZE / 1024) * TIMER_FREQ
+          / (slow_ticks > 0 ? slow_ticks : 1));
+  palloc_free_multiple (pages, 2);
+}
+
+static void
+fast_copy (void *dst, void *src)
+{
+  memcpy (dst, src, PGSIZE);
+}
+
+/* Copies a page a byte at a time.  The volatile pointer keeps
+   the compiler from turning the loop into a call to memcpy(). */
+static void
+slow_copy (void *dst_, void *src_)
+{
+  volatile uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+  size_t i;
+
+  for (i = 0; i < PGSIZE; i++)
+    dst[i] = src[i];
+}
+
+static void
+fast_zero (void *dst, void *src UNUSED)
+{
+  memset (dst, 0, PGSIZE);
+}
+
+/* Zeroes a page a byte at a time. */
+static void
+slow_zero (void *dst_, void *src UNUSED)
+{
+  volatile uint8_t *dst = dst_;
+  size_t i;
+
+  for (i = 0; i < PGSIZE; i++)
+    dst[i] = 0;
+}
@@ -0,0 +1,110 @@
+/* Allocates and frees runs of 1 to 64 user pages in random order,
+   so that the user pool fragments, and prints how long each round
+   of operations takes.  Each page of a run is tagged with its
+   owner, and the tags are checked when the run is freed, to catch
+   runs that overlap.  At the end, with every run freed, a 64-page
+   run must be available again. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define SLOT_CNT 32             /* Runs held at once, at most. */
+#define MAX_RUN 64              /* Largest run, in pages. */
+#define ROUND_CNT 8             /* Rounds of operations. */
+#define OP_CNT 1000             /* Operations per round. */
+
+/* A run of pages held by the test. */
+struct run
+  {
+    void *pages;                /* First page, or a null pointer. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+static void tag_run (struct run *, unsigned tag);
+static void free_run (struct run *, unsigned tag);
+
+void
+test_palloc_frag (void)
+{
+  struct run runs[SLOT_CNT];
+  void *pages;
+  int round;
+  size_t i;
+
+  random_init (0);
+  for (i = 0; i < SLOT_CNT; i++)
+    runs[i].pages = NULL;
+
+  msg ("allocating and freeing runs of 1 to %d user pages", MAX_RUN);
+  for (round = 1; round <= ROUND_CNT; round++)
+    {
+      int64_t start = timer_ticks ();
+      size_t live_cnt = 0;
+      int failed_cnt = 0;
+      int op;
+
+      for (op = 0; op < OP_CNT; op++)
+        {
+          size_t slot = random_ulong () % SLOT_CNT;
+          struct run *r = &runs[slot];
+
+          if (r->pages != NULL)
+            free_run (r, slot);
+          else
+            {
+              r->page_cnt = random_ulong () % MAX_RUN + 1;
+              r->pages = palloc_get_multiple (PAL_USER, r->page_cnt);
+              if (r->pages != NULL)
+                tag_run (r, slot);
+              else
+                failed_cnt++;
+            }
+        }
+
+      for (i = 0; i < SLOT_CNT; i++)
+        if (runs[i].pages != NULL)
+          live_cnt += runs[i].page_cnt;
+      msg ("round %d: %"PRId64" ticks for %d operations, "
+           "%zu pages held, %d allocations failed",
+           round, timer_elapsed (start), OP_CNT, live_cnt, failed_cnt);
+    }
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (runs[i].pages != NULL)
+      free_run (&runs[i], i);
+  msg ("freed all runs");
+
+  pages = palloc_get_multiple (PAL_USER, MAX_RUN);
+  if (pages == NULL)
+    fail ("could not allocate %d pages after freeing everything", MAX_RUN);
+  palloc_free_multiple (pages, MAX_RUN);
+  pass ();
+}
+
+/* Writes TAG at the start of each page of R. */
+static void
+tag_run (struct run *r, unsigned tag)
+{
+  size_t i;
+
+  for (i = 0; i < r->page_cnt; i++)
+    *(unsigned *) ((uint8_t *) r->pages + i * PGSIZE) = tag;
+}
+
+/* Checks that each page of R still carries TAG, then frees R. */
+static void
+free_run (struct run *r, unsigned tag)
+{
+  size_t i;
+
+  for (i = 0; i < r->page_cnt; i++)
+    if (*(unsigned *) ((uint8_t *) r->pages + i * PGSIZE) != tag)
+      fail ("page %zu of run %u was overwritten", i, tag);
+  palloc_free_multiple (r->pages, r->page_cnt);
+  r->pages = NULL;
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(palloc-frag\) round \d+: /, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(palloc-frag) begin
+(palloc-frag) allocating and freeing runs of 1 to 64 user pages
+(palloc-frag) freed all runs
+(palloc-frag) PASS
+(palloc-frag) end
+EOF
+pass;
@@ -0,0 +1,63 @@
+/* Checks that pages allocated with PAL_ZERO are zeroed, whether
+   the idle thread zeroed them ahead of time or not.  Rounds
+   alternate between the user and kernel pools, every other pair
+   of rounds sleeps first to let the idle thread zero pages, and
+   each round asks for more pages than the idle thread keeps, so
+   pages zeroed ahead and on demand are both checked.  Each round
+   dirties its pages before freeing them. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 64             /* Pages allocated per round. */
+#define ROUND_CNT 6             /* Rounds. */
+
+static void check_zero (const uint8_t *page, int round);
+
+void
+test_palloc_zero (void)
+{
+  static void *pages[PAGE_CNT];
+  enum palloc_flags pools[] = {PAL_USER, 0};
+  int round;
+  size_t i;
+
+  msg ("allocating %d zeroed pages in each of %d rounds",
+       PAGE_CNT, ROUND_CNT);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      enum palloc_flags pool = pools[round % 2];
+
+      /* Give the idle thread time to zero pages. */
+      if (round / 2 % 2 == 0)
+        timer_sleep (10);
+
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          pages[i] = palloc_get_page (pool | PAL_ZERO);
+          if (pages[i] == NULL)
+            fail ("out of pages in round %d", round);
+          check_zero (pages[i], round);
+          memset (pages[i], 0x5a, PGSIZE);
+        }
+      for (i = 0; i < PAGE_CNT; i++)
+        palloc_free_page (pages[i]);
+    }
+  msg ("all pages were zero");
+  pass ();
+}
+
+/* Fails unless PAGE, allocated in ROUND, is all zeros. */
+static void
+check_zero (const uint8_t *page, int round)
+{
+  size_t i;
+
+  for (i = 0; i < PGSIZE; i++)
+    if (page[i] != 0)
+      fail ("byte %zu of a page from round %d is %#x", i, round, page[i]);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) allocating 64 zeroed pages in each of 6 rounds
+(palloc-zero) all pages were zero
+(palloc-zero) PASS
+(palloc-zero) end
+EOF
+pass;
@@ -0,0 +1,11 @@
+/* Child process run by spawn-multiple.
+   Exits with the code given as its first argument, without
+   printing anything. */
+
+#include <stdlib.h>
+
+int
+main (int argc, char *argv[]) 
+{
+  return argc > 1 ? atoi (argv[1]) : 0;
+}
@@ -0,0 +1,23 @@
+/* Executes child-simple, then overwrites its ELF header and tries
+   to execute it again.  The second exec must notice the change and
+   fail, even though the kernel may have cached the executable. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char junk[4];
+  int handle;
+
+  wait (exec ("child-simple"));
+
+  CHECK ((handle = open ("child-simple")) > 1, "open \"child-simple\"");
+  CHECK (write (handle, junk, sizeof junk) == sizeof junk,
+         "overwrite ELF header");
+  close (handle);
+
+  msg ("exec(\"child-simple\"): %d", exec ("child-simple"));
+}
@@ -0,0 +1,56 @@
+/* Writes 10,000 small records to a file through a submission ring,
+   a full ring per system call, then checks the file.  Compare the
+   "Timer:" line of the output with write-many, which uses one write
+   system call per record. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RECORD_CNT 10000        /* Number of records. */
+#define RECORD_SIZE 16          /* Bytes per record. */
+
+static char data[RECORD_CNT * RECORD_SIZE];
+static struct io_ring ring;
+
+void
+test_main (void)
+{
+  size_t queued = 0, completed = 0;
+  size_t i;
+  int handle;
+
+  for (i = 0; i < sizeof data; i++)
+    data[i] = 'a' + i % 26;
+
+  CHECK (create ("bench", sizeof data), "create \"bench\"");
+  CHECK ((handle = open ("bench")) > 1, "open \"bench\"");
+
+  msg ("write %d records", RECORD_CNT);
+  while (completed < RECORD_CNT)
+    {
+      while (queued < RECORD_CNT && ring.sq_tail - ring.sq_head < IO_RING_SIZE)
+        {
+          struct io_sqe *sqe = &ring.sq[ring.sq_tail++ % IO_RING_SIZE];
+          sqe->op = IO_WRITE;
+          sqe->fd = handle;
+          sqe->buf = data + queued * RECORD_SIZE;
+          sqe->len = RECORD_SIZE;
+          sqe->user_data = queued++;
+        }
+
+      if (io_submit (&ring) < 0)
+        fail ("io_submit failed");
+
+      for (; ring.cq_head != ring.cq_tail; ring.cq_head++)
+        {
+          struct io_cqe *cqe = &ring.cq[ring.cq_head % IO_RING_SIZE];
+          if (cqe->result != RECORD_SIZE)
+            fail ("write of record %u failed", cqe->user_data);
+          completed++;
+        }
+    }
+  close (handle);
+
+  check_file ("bench", data, sizeof data);
+}
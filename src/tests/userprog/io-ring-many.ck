@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(io-ring-many) begin
+(io-ring-many) create "bench"
+(io-ring-many) open "bench"
+(io-ring-many) write 10000 records
+(io-ring-many) open "bench" for verification
+(io-ring-many) verified contents of "bench"
+(io-ring-many) close "bench"
+(io-ring-many) end
+io-ring-many: exit(0)
+EOF
+pass;
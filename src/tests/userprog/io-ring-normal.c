@@ -0,0 +1,71 @@
+/* Opens a file, writes sample.txt to it, reads it back and closes
+   it through a submission ring, checking every completion. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct io_ring ring;
+
+/* Queues one operation on the ring. */
+static void
+queue (int op, int fd, void *buf, unsigned len, unsigned user_data)
+{
+  struct io_sqe *sqe = &ring.sq[ring.sq_tail++ % IO_RING_SIZE];
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->user_data = user_data;
+}
+
+/* Takes the next completion off the ring, checks that it belongs to
+   USER_DATA and returns its result. */
+static int
+complete (unsigned user_data)
+{
+  struct io_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("completion queue empty");
+  cqe = &ring.cq[ring.cq_head++ % IO_RING_SIZE];
+  if (cqe->user_data != user_data)
+    fail ("completion for %u, expected %u", cqe->user_data, user_data);
+  return cqe->result;
+}
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char buf[sizeof sample];
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+
+  queue (IO_OPEN, 0, "test.txt", 0, 1);
+  CHECK (io_submit (&ring) == 1, "submit open");
+  CHECK ((handle = complete (1)) > 1, "open \"test.txt\"");
+
+  queue (IO_WRITE, handle, sample, size, 2);
+  queue (IO_CLOSE, handle, NULL, 0, 3);
+  queue (IO_OPEN, 0, "test.txt", 0, 4);
+  CHECK (io_submit (&ring) == 3, "submit write, close and open");
+  CHECK (complete (2) == (int) size, "write \"test.txt\"");
+  CHECK (complete (3) == 0, "close \"test.txt\"");
+  CHECK ((handle = complete (4)) > 1, "reopen \"test.txt\"");
+
+  queue (IO_READ, handle, buf, size, 5);
+  queue (IO_READ, 12345, buf, size, 6);
+  queue (IO_CLOSE, handle, NULL, 0, 7);
+  CHECK (io_submit (&ring) == 3, "submit read, bad read and close");
+  CHECK (complete (5) == (int) size, "read \"test.txt\"");
+  CHECK (complete (6) == -1, "read from bad fd fails");
+  CHECK (complete (7) == 0, "close \"test.txt\"");
+
+  if (memcmp (buf, sample, size))
+    fail ("read data differs from data written");
+  CHECK (io_submit (&ring) == 0, "submit empty ring");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(io-ring-normal) begin
+(io-ring-normal) create "test.txt"
+(io-ring-normal) submit open
+(io-ring-normal) open "test.txt"
+(io-ring-normal) submit write, close and open
+(io-ring-normal) write "test.txt"
+(io-ring-normal) close "test.txt"
+(io-ring-normal) reopen "test.txt"
+(io-ring-normal) submit read, bad read and close
+(io-ring-normal) read "test.txt"
+(io-ring-normal) read from bad fd fails
+(io-ring-normal) close "test.txt"
+(io-ring-normal) submit empty ring
+(io-ring-normal) end
+io-ring-normal: exit(0)
+EOF
+pass;
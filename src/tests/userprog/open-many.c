@@ -0,0 +1,33 @@
+/* Opens the same file many more times than a new file descriptor
+   table has room for, then checks that descriptors are handed out
+   lowest first and that a closed descriptor is reused. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OPEN_CNT 100
+
+void
+test_main (void) 
+{
+  int handles[OPEN_CNT];
+  char byte;
+  int i;
+
+  msg ("open \"sample.txt\" %d times", OPEN_CNT);
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      handles[i] = open ("sample.txt");
+      if (handles[i] != i + 2)
+        fail ("open %d returned %d, expected %d", i, handles[i], i + 2);
+    }
+
+  CHECK (read (handles[OPEN_CNT - 1], &byte, 1) == 1,
+         "read from last descriptor");
+  close (handles[OPEN_CNT / 2]);
+  CHECK (open ("sample.txt") == handles[OPEN_CNT / 2],
+         "reopen reuses closed descriptor");
+  for (i = 0; i < OPEN_CNT; i++)
+    close (handles[i]);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) open "sample.txt" 100 times
+(open-many) read from last descriptor
+(open-many) reopen reuses closed descriptor
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Reads parts of sample.txt at explicit offsets with pread and
+   checks that the file position is not moved. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[64];
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  byte_cnt = pread (handle, buf, sizeof buf, 100);
+  if (byte_cnt != (int) sizeof buf)
+    fail ("pread() returned %d instead of %zu", byte_cnt, sizeof buf);
+  compare_bytes (buf, sample + 100, sizeof buf, 100, "sample.txt");
+
+  byte_cnt = pread (handle, buf, sizeof buf, size - 10);
+  if (byte_cnt != 10)
+    fail ("pread() at end of file returned %d instead of 10", byte_cnt);
+  compare_bytes (buf, sample + size - 10, 10, size - 10, "sample.txt");
+
+  CHECK (tell (handle) == 0, "file position unchanged");
+}
@@ -0,0 +1,28 @@
+/* Writes sample.txt to a new file back to front with pwrite, then
+   checks the file's contents and that the file position was not
+   moved. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  size_t half = size / 2;
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  CHECK (pwrite (handle, sample + half, size - half, half)
+         == (int) (size - half), "pwrite second half");
+  CHECK (pwrite (handle, sample, half, 0) == (int) half,
+         "pwrite first half");
+  CHECK (tell (handle) == 0, "file position unchanged");
+  close (handle);
+
+  check_file ("test.txt", sample, size);
+}
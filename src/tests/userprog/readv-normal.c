@@ -0,0 +1,38 @@
+/* Reads sample.txt into three buffers with a single readv system
+   call and checks that each buffer was filled in turn. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char head[16];
+static char middle[32];
+static char body[sizeof sample];
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  size_t body_ofs = sizeof head + sizeof middle;
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  iov[0].iov_base = head;
+  iov[0].iov_len = sizeof head;
+  iov[1].iov_base = middle;
+  iov[1].iov_len = sizeof middle;
+  iov[2].iov_base = body;
+  iov[2].iov_len = sizeof body;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("readv() returned %d instead of %zu", byte_cnt, size);
+
+  compare_bytes (head, sample, sizeof head, 0, "sample.txt");
+  compare_bytes (middle, sample + sizeof head, sizeof middle,
+                 sizeof head, "sample.txt");
+  compare_bytes (body, sample + body_ofs, size - body_ofs,
+                 body_ofs, "sample.txt");
+}
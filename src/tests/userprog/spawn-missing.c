@@ -0,0 +1,15 @@
+/* Spawns a nonexistent process.  The spawn system call returns
+   before the load fails, so waiting for the child must return -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  CHECK ((pid = spawn ("no-such-file")) != PID_ERROR, "spawn(\"no-such-file\")");
+  msg ("wait: %d", wait (pid));
+}
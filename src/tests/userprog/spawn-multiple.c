@@ -0,0 +1,34 @@
+/* Spawns several child processes at once, so that their loads can
+   overlap, then waits for each of them and checks its exit code.
+   Compare the "Timer:" line of the output with exec-multiple,
+   which runs its children one at a time. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 8
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      char cmd[32];
+
+      snprintf (cmd, sizeof cmd, "child-exit %d", i);
+      CHECK ((children[i] = spawn (cmd)) != PID_ERROR, "spawn(\"%s\")", cmd);
+    }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      int code = wait (children[i]);
+      if (code != i)
+        fail ("wait for child %d returned %d", i, code);
+    }
+  msg ("all children exited");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(spawn-multiple) begin
+(spawn-multiple) spawn("child-exit 0")
+(spawn-multiple) spawn("child-exit 1")
+(spawn-multiple) spawn("child-exit 2")
+(spawn-multiple) spawn("child-exit 3")
+(spawn-multiple) spawn("child-exit 4")
+(spawn-multiple) spawn("child-exit 5")
+(spawn-multiple) spawn("child-exit 6")
+(spawn-multiple) spawn("child-exit 7")
+(spawn-multiple) all children exited
+(spawn-multiple) end
+EOF
+pass;
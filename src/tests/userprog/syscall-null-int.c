@@ -0,0 +1,29 @@
+/* Makes 100,000 system calls that do next to no work, always
+   through the int $0x30 gate.  Compare the "Timer:" line of the
+   output with syscall-null, which uses SYSENTER where the CPU has
+   it. */
+
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALL_CNT 100000
+
+void
+test_main (void)
+{
+  int i;
+
+  msg ("make %d system calls", CALL_CNT);
+  for (i = 0; i < CALL_CNT; i++)
+    {
+      int retval;
+
+      asm volatile ("pushl $0; pushl %[number]; int $0x30; addl $8, %%esp"
+                    : "=a" (retval)
+                    : [number] "i" (SYS_TELL)
+                    : "memory");
+      if (retval != -1)
+        fail ("tell(0) returned a position");
+    }
+}
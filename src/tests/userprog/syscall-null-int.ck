@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(syscall-null-int) begin
+(syscall-null-int) make 100000 system calls
+(syscall-null-int) end
+syscall-null-int: exit(0)
+EOF
+pass;
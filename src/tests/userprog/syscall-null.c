@@ -0,0 +1,21 @@
+/* Makes 100,000 system calls that do next to no work, through the
+   user library, which enters the kernel with SYSENTER where the
+   CPU has it.  Compare the "Timer:" line of the output with
+   syscall-null-int, which always uses the int $0x30 gate. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALL_CNT 100000
+
+void
+test_main (void)
+{
+  int i;
+
+  msg ("make %d system calls", CALL_CNT);
+  for (i = 0; i < CALL_CNT; i++)
+    if (tell (0) != (unsigned) -1)
+      fail ("tell(0) returned a position");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(syscall-null) begin
+(syscall-null) make 100000 system calls
+(syscall-null) end
+syscall-null: exit(0)
+EOF
+pass;
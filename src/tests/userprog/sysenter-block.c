@@ -0,0 +1,32 @@
+/* Blocks in a system call, then uses memory long enough for
+   timer interrupts to arrive in user mode.  On CPUs with
+   SYSENTER, system calls enter through the fast path, and a
+   process that blocked in one must still come back with user
+   data segments, or the first interrupt's return nulls them and
+   the next memory access faults. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUND_CNT 3             /* Blocking calls made. */
+#define PASS_CNT 2000           /* Passes over BUF per round. */
+
+static volatile char buf[4096];
+
+void
+test_main (void) 
+{
+  int round;
+
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      int pass;
+      size_t i;
+
+      msg ("wait(exec()) = %d", wait (exec ("child-simple")));
+      for (pass = 0; pass < PASS_CNT; pass++)
+        for (i = 0; i < sizeof buf; i++)
+          buf[i] = buf[i] + pass;
+    }
+}
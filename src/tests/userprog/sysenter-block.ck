@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sysenter-block) begin
+(child-simple) run
+child-simple: exit(81)
+(sysenter-block) wait(exec()) = 81
+(child-simple) run
+child-simple: exit(81)
+(sysenter-block) wait(exec()) = 81
+(child-simple) run
+child-simple: exit(81)
+(sysenter-block) wait(exec()) = 81
+(sysenter-block) end
+sysenter-block: exit(0)
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Writes 10,000 small records to a file with one write system call
+   each, then checks the file.  Compare the "Timer:" line of the
+   output with io-ring-many, which writes the same records through a
+   submission ring. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RECORD_CNT 10000        /* Number of records. */
+#define RECORD_SIZE 16          /* Bytes per record. */
+
+static char data[RECORD_CNT * RECORD_SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+  int handle;
+
+  for (i = 0; i < sizeof data; i++)
+    data[i] = 'a' + i % 26;
+
+  CHECK (create ("bench", sizeof data), "create \"bench\"");
+  CHECK ((handle = open ("bench")) > 1, "open \"bench\"");
+
+  msg ("write %d records", RECORD_CNT);
+  for (i = 0; i < RECORD_CNT; i++)
+    if (write (handle, data + i * RECORD_SIZE, RECORD_SIZE) != RECORD_SIZE)
+      fail ("write of record %zu failed", i);
+  close (handle);
+
+  check_file ("bench", data, sizeof data);
+}
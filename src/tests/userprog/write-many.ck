@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(write-many) begin
+(write-many) create "bench"
+(write-many) open "bench"
+(write-many) write 10000 records
+(write-many) open "bench" for verification
+(write-many) verified contents of "bench"
+(write-many) close "bench"
+(write-many) end
+write-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,23 @@
+/* Passes an iovec with an invalid buffer pointer to the writev
+   system call.  The process must be terminated with -1 exit code
+   before anything is written. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[2];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  iov[0].iov_base = "Valid";
+  iov[0].iov_len = 5;
+  iov[1].iov_base = (char *) 0x10123420;
+  iov[1].iov_len = 123;
+  writev (handle, iov, 2);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-bad-ptr) begin
+(writev-bad-ptr) open "sample.txt"
+writev-bad-ptr: exit(-1)
+EOF
+pass;
@@ -0,0 +1,24 @@
+/* Passes writev iovecs whose lengths add up to more than INT_MAX
+   bytes.  The byte count could not be returned, so the call must
+   fail with -1 before anything is written or checked, and the
+   process must carry on. */
+
+#include <limits.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[2];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  iov[0].iov_base = "Valid";
+  iov[0].iov_len = INT_MAX;
+  iov[1].iov_base = "Valid";
+  iov[1].iov_len = 5;
+  CHECK (writev (handle, iov, 2) == -1, "writev of more than INT_MAX bytes");
+}
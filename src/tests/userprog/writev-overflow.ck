@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-overflow) begin
+(writev-overflow) open "sample.txt"
+(writev-overflow) writev of more than INT_MAX bytes
+(writev-overflow) end
+writev-overflow: exit(0)
+EOF
+pass;
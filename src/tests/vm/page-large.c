@@ -0,0 +1,58 @@
+/* Fills and checks a 4 MB array in the BSS that is aligned to
+   4 MB, so that the loader can map it with a single resident
+   large page, then passes part of it to write() and read().
+   Run with enough memory for the user pool to hold an aligned
+   4 MB run; with less, or with -nopse, the array is demand
+   paged instead and the output is the same.  Compare the
+   "Timer:" line of the output with and without -nopse to
+   benchmark the large mapping. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 1024 * 1024)          /* Size of the array. */
+#define IO_SIZE (64 * 1024)             /* Bytes passed to write(). */
+
+static unsigned char buf[SIZE] __attribute__ ((aligned (SIZE)));
+
+/* Returns the byte expected at offset OFS of BUF. */
+static unsigned char
+pattern (size_t ofs)
+{
+  return (ofs * 7 + (ofs >> 12)) & 0xff;
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int handle;
+
+  msg ("zero pass");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu != 0", i);
+
+  msg ("write pass");
+  for (i = 0; i < SIZE; i++)
+    buf[i] = pattern (i);
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != pattern (i))
+      fail ("byte %zu differs", i);
+
+  /* The system calls' buffers start mid-page and cross pages. */
+  CHECK (create ("large", IO_SIZE), "create \"large\"");
+  CHECK ((handle = open ("large")) > 1, "open \"large\"");
+  if (write (handle, buf + 100, IO_SIZE) != IO_SIZE)
+    fail ("write failed");
+  seek (handle, 0);
+  if (read (handle, buf + SIZE / 2 + 100, IO_SIZE) != IO_SIZE)
+    fail ("read failed");
+  for (i = 0; i < IO_SIZE; i++)
+    if (buf[SIZE / 2 + 100 + i] != pattern (100 + i))
+      fail ("byte %zu read back differs", i);
+  close (handle);
+}
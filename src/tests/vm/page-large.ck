@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-large) begin
+(page-large) zero pass
+(page-large) write pass
+(page-large) read pass
+(page-large) create "large"
+(page-large) open "large"
+(page-large) end
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Touches a range of fresh pages and checks that the memstat
+   system call accounts for the page faults and resident frames
+   that this causes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 64
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  struct memstat before, after;
+  size_t i;
+
+  CHECK (memstat (&before), "memstat before touching pages");
+  msg ("touch %d pages", PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i;
+  CHECK (memstat (&after), "memstat after touching pages");
+
+  if (after.faults < before.faults + PAGE_CNT)
+    fail ("only %u page faults for %d new pages",
+          after.faults - before.faults, PAGE_CNT);
+  if (after.resident < PAGE_CNT)
+    fail ("only %u resident frames after touching %d pages",
+          after.resident, PAGE_CNT);
+  if (after.working_set > after.resident)
+    fail ("working set of %u frames exceeds %u resident frames",
+          after.working_set, after.resident);
+}
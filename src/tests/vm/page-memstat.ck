@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-memstat) begin
+(page-memstat) memstat before touching pages
+(page-memstat) touch 64 pages
+(page-memstat) memstat after touching pages
+(page-memstat) end
+EOF
+pass;
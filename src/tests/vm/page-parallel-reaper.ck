@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-parallel-reaper) begin
+(page-parallel-reaper) exec "child-linear"
+(page-parallel-reaper) exec "child-linear"
+(page-parallel-reaper) exec "child-linear"
+(page-parallel-reaper) exec "child-linear"
+(page-parallel-reaper) wait for child 0
+(page-parallel-reaper) wait for child 1
+(page-parallel-reaper) wait for child 2
+(page-parallel-reaper) wait for child 3
+(page-parallel-reaper) end
+EOF
+pass;
@@ -0,0 +1,55 @@
+/* Writes buffers of 1 byte up to 1 MB to a file, one system call
+   per buffer, and reads them back.  The 1 MB buffer spans more
+   pages than a small user pool holds, so it must be paged while
+   the system call runs.  Compare the "Timer:" line of the output
+   between kernels to benchmark system call throughput. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define MAX_SIZE (1024 * 1024)          /* Largest buffer. */
+#define MIN_BYTES (16 * 1024)           /* Bytes written per buffer size. */
+
+static unsigned char buf[MAX_SIZE];
+
+/* Returns the byte expected at offset OFS of a SIZE-byte buffer. */
+static unsigned char
+pattern (size_t size, size_t ofs)
+{
+  return (ofs * 7 + size) & 0xff;
+}
+
+void
+test_main (void)
+{
+  size_t size, i;
+  int handle;
+
+  CHECK (create ("bench", MAX_SIZE), "create \"bench\"");
+  CHECK ((handle = open ("bench")) > 1, "open \"bench\"");
+
+  for (size = 1; size <= MAX_SIZE; size *= 4)
+    {
+      size_t calls = size < MIN_BYTES ? MIN_BYTES / size : 1;
+
+      for (i = 0; i < size; i++)
+        buf[i] = pattern (size, i);
+
+      msg ("write %zu bytes %zu times", size, calls);
+      seek (handle, 0);
+      for (i = 0; i < calls; i++)
+        if (write (handle, buf, size) != (int) size)
+          fail ("write of %zu bytes failed", size);
+
+      for (i = 0; i < size; i++)
+        buf[i] = 0;
+      seek (handle, 0);
+      if (read (handle, buf, size) != (int) size)
+        fail ("read of %zu bytes failed", size);
+      for (i = 0; i < size; i++)
+        if (buf[i] != pattern (size, i))
+          fail ("byte %zu of %zu-byte buffer differs", i, size);
+    }
+  close (handle);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-write-sizes) begin
+(page-write-sizes) create "bench"
+(page-write-sizes) open "bench"
+(page-write-sizes) write 1 bytes 16384 times
+(page-write-sizes) write 4 bytes 4096 times
+(page-write-sizes) write 16 bytes 1024 times
+(page-write-sizes) write 64 bytes 256 times
+(page-write-sizes) write 256 bytes 64 times
+(page-write-sizes) write 1024 bytes 16 times
+(page-write-sizes) write 4096 bytes 4 times
+(page-write-sizes) write 16384 bytes 1 times
+(page-write-sizes) write 65536 bytes 1 times
+(page-write-sizes) write 262144 bytes 1 times
+(page-write-sizes) write 1048576 bytes 1 times
+(page-write-sizes) end
+EOF
+pass;
@@ -26,6 +26,7 @@
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
@@ -45,6 +46,15 @@
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* True if the CPU maps large (4 MB) pages. */
+bool init_large_pages;
+
+/* -nopse: Map the kernel with 4 kB pages only? */
+static bool no_large_pages;
+
+/* True if kernel mappings are global, see paging_init(). */
+static bool global_pages;
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -61,6 +71,16 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifdef USERPROG
+/* -reaper: Free exited processes' page tables in the background? */
+static bool start_reaper;
+#endif
+
+#ifdef VM
+/* -zswap: Maximum number of kernel pages for compressed swap. */
+static size_t zswap_page_limit;
+#endif
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -106,6 +126,7 @@ main (void)
   /* Initialize virtual memory frames. */
 #ifdef VM
   init_frames ();
+  init_pages ();
 #endif
 
   /* Segmentation. */
@@ -122,12 +143,17 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+#ifdef USERPROG
+  if (start_reaper)
+    pagedir_start_reaper ();
+#endif
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -135,7 +161,9 @@ main (void)
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
-  swap_init();
+#ifdef VM
+  swap_init (zswap_page_limit);
+#endif
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -159,17 +187,37 @@ bss_init (void)
   memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* CR4 bits that enable large (4 MB) pages and global pages.
+   See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PSE 0x00000010
+#define CR4_PGE 0x00000080
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports it, each 4 MB chunk of RAM that lies
+   entirely in physical memory and holds no kernel text is
+   mapped by a single large page, which saves a page table per
+   4 MB and lets one TLB entry cover it.  Kernel text keeps
+   4 kB mappings so that it stays read-only.
+
+   Kernel mappings are the same in every page directory and never
+   change after this point, so if the CPU supports it they are
+   marked global and survive the CR3 reload of a context switch. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
+  uint32_t global;
   extern char _start, _end_kernel_text;
 
+  init_large_pages = !no_large_pages && (cpu_features () & CPUID_PSE);
+  global_pages = (cpu_features () & CPUID_PGE) != 0;
+  global = global_pages ? PTE_G : 0;
+
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
@@ -180,13 +228,32 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (init_large_pages && pte_idx == 0
+          && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || &_end_kernel_text <= vaddr))
+        {
+          pd[pde_idx] = pde_create_large_kernel (vaddr, true) | global;
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
+    }
+
+  /* Large and global pages must be enabled before the page
+     directory that uses them is loaded. */
+  if (init_large_pages || global_pages)
+    {
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      cr4 |= (init_large_pages ? CR4_PSE : 0) | (global_pages ? CR4_PGE : 0);
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4));
     }
 
   /* Store the physical address of the page directory into CR3
@@ -197,6 +264,17 @@ paging_init (void)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
 }
 
+/* Returns the CPU's feature flags, as reported in EDX by CPUID
+   leaf 1.  See [IA32-v2a] "CPUID--CPU Identification". */
+uint32_t
+cpu_features (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return edx;
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char **
@@ -265,9 +343,17 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-nopse"))
+        no_large_pages = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-reaper"))
+        start_reaper = true;
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-zswap"))
+        zswap_page_limit = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -301,6 +387,13 @@ run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+/* Has the allocator statistics printed at power off. */
+static void
+show_memstats (char **argv UNUSED)
+{
+  shutdown_show_memory_stats ();
+}
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -318,6 +411,7 @@ run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},
+      {"memstats", 1, show_memstats},
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
@@ -366,6 +460,7 @@ usage (void)
 #else
           "  run TEST           Run TEST.\n"
 #endif
+          "  memstats           Print memory allocator statistics at power off.\n"
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
@@ -388,8 +483,13 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -nopse             Map kernel memory with 4 kB pages only.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -reaper            Free exited processes' memory in the background.\n"
+#endif
+#ifdef VM
+          "  -zswap=COUNT       Compress up to COUNT kernel pages of swap in RAM.\n"
 #endif
           );
   shutdown_power_off ();
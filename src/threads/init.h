@@ -9,4 +9,14 @@
 /* Page directory with kernel mappings only. */
 extern uint32_t *init_page_dir;
 
+/* True if the CPU maps large (4 MB) pages, see paging_init(). */
+extern bool init_large_pages;
+
+/* CPUID leaf 1 EDX bits, as returned by cpu_features(). */
+#define CPUID_PSE 0x00000008    /* Large pages. */
+#define CPUID_SEP 0x00000800    /* SYSENTER and SYSEXIT. */
+#define CPUID_PGE 0x00002000    /* Global pages. */
+
+uint32_t cpu_features (void);
+
 #endif /* threads/init.h */
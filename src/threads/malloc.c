@@ -11,36 +11,61 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
-
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  The classes are the powers of 2
+   from 16 bytes plus the points halfway between them from 48
+   bytes on, so no request wastes more than a third of its block.
+
+   Blocks are carved from pages of memory called "arenas", each
+   of which keeps a list of its own free blocks.  A descriptor
+   keeps a list of its arenas that have free blocks, and the
+   request is satisfied from the first of them.  If there is
+   none, a new arena is obtained from the page allocator (if none
+   is available, malloc() returns a null pointer), divided into
+   blocks, and put on the list.
+
+   When we free a block, we add it to its arena's free list, and
+   put the arena back on its descriptor's list if it was full.
+   If the arena now has no in-use blocks, we give it back to the
+   page allocator, which takes constant time because its blocks
+   are on no list but its own.  Each descriptor keeps one empty
+   arena back, though, so that a caller that allocates and frees
+   a single block over and over does not get and free a page
+   every time.
+
+   We can't handle blocks bigger than 1.5 kB using this scheme,
+   because no more than one would fit in a single page with an
+   arena header.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Each descriptor counts the blocks it hands out, for
+   malloc_print_stats().  In kernels built with MALLOC_TRACE=1 on
+   the make command line, each block also carries a struct tag in
+   front of it naming the "file:line" that allocated it, and the
+   statistics list where the blocks still in use came from. */
+
+/* The macros that pass the caller's site are for everyone else. */
+#undef malloc
+#undef calloc
+#undef realloc
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
-    struct list free_list;      /* List of free blocks. */
+    struct list arena_list;     /* Arenas with free blocks. */
+    struct arena *spare;        /* Empty arena kept back, if any. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics. */
+    size_t used_cnt;            /* Blocks in use. */
+    size_t peak_cnt;            /* Most blocks ever in use. */
+    unsigned alloc_cnt;         /* Successful requests. */
+    unsigned fail_cnt;          /* Failed requests. */
+    size_t page_cnt;            /* Pages held, counting the spare. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -52,6 +77,8 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct list free_list;      /* Free blocks in this arena. */
+    struct list_elem desc_elem; /* Element in desc's arena_list. */
   };
 
 /* Free block. */
@@ -60,10 +87,37 @@ struct block
     struct list_elem free_elem; /* Free list element. */
   };
 
+/* Block sizes of the descriptors, in increasing order: the
+   powers of 2 and, from 48 bytes on, the sizes halfway between
+   them, up to the largest that still fits twice in an arena. */
+static const size_t block_sizes[] =
+  {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536};
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[sizeof block_sizes / sizeof *block_sizes];
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics of blocks too big for any descriptor.  Only its lock
+   and statistics are used. */
+static struct desc big_desc;
+
+#ifdef MALLOC_TRACE
+/* Header in front of each block in MALLOC_TRACE kernels. */
+struct tag
+  {
+    const char *site;           /* "file:line" that allocated the block. */
+    size_t size;                /* Bytes requested. */
+    struct list_elem elem;      /* Element in tag_list. */
+  };
+
+/* Blocks in use, and the lock that protects the list. */
+static struct list tag_list = LIST_INITIALIZER (tag_list);
+static struct lock tag_lock;
+#endif
+
+static void *alloc_block (size_t size);
+static void free_block (void *);
+static void count_alloc (struct desc *);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -71,23 +125,59 @@ static struct block *arena_to_block (struct arena *, size_t idx);
 void
 malloc_init (void) 
 {
-  size_t block_size;
-
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  for (desc_cnt = 0; desc_cnt < sizeof descs / sizeof *descs; desc_cnt++)
     {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
+      struct desc *d = &descs[desc_cnt];
+      d->block_size = block_sizes[desc_cnt];
+      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / d->block_size;
+      ASSERT (d->blocks_per_arena >= 2);
+      list_init (&d->arena_list);
+      d->spare = NULL;
       lock_init (&d->lock);
     }
+  lock_init (&big_desc.lock);
+#ifdef MALLOC_TRACE
+  lock_init (&tag_lock);
+#endif
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return malloc_at (size, NULL);
+}
+
+/* Like malloc(), but records SITE as the place the block was
+   allocated from in MALLOC_TRACE kernels. */
+void *
+malloc_at (size_t size, const char *site UNUSED) 
+{
+#ifdef MALLOC_TRACE
+  struct tag *t;
+
+  if (size == 0)
+    return NULL;
+  t = alloc_block (sizeof *t + size);
+  if (t == NULL)
+    return NULL;
+  t->site = site != NULL ? site : "unknown";
+  t->size = size;
+  lock_acquire (&tag_lock);
+  list_push_back (&tag_list, &t->elem);
+  lock_release (&tag_lock);
+  return t + 1;
+#else
+  return alloc_block (size);
+#endif
+}
+
+/* Obtains and returns a new block of at least SIZE bytes from the
+   descriptors or, if it is too big, directly from the page
+   allocator.  Returns a null pointer if memory is not available. */
+static void *
+alloc_block (size_t size) 
 {
   struct desc *d;
   struct block *b;
@@ -108,6 +198,15 @@ malloc (size_t size)
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
       a = palloc_get_multiple (0, page_cnt);
+      lock_acquire (&big_desc.lock);
+      if (a != NULL)
+        {
+          count_alloc (&big_desc);
+          big_desc.page_cnt += page_cnt;
+        }
+      else
+        big_desc.fail_cnt++;
+      lock_release (&big_desc.lock);
       if (a == NULL)
         return NULL;
 
@@ -121,34 +220,49 @@ malloc (size_t size)
 
   lock_acquire (&d->lock);
 
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* If no arena has a free block, use the spare or create a new
+     arena. */
+  if (list_empty (&d->arena_list))
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
+      if (d->spare != NULL)
         {
-          lock_release (&d->lock);
-          return NULL; 
+          a = d->spare;
+          d->spare = NULL;
         }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
+      else
         {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
+          size_t i;
+
+          /* Allocate a page. */
+          a = palloc_get_page (0);
+          if (a == NULL) 
+            {
+              d->fail_cnt++;
+              lock_release (&d->lock);
+              return NULL; 
+            }
+          d->page_cnt++;
+
+          /* Initialize arena and add its blocks to its free list. */
+          a->magic = ARENA_MAGIC;
+          a->desc = d;
+          a->free_cnt = d->blocks_per_arena;
+          list_init (&a->free_list);
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_push_back (&a->free_list, &b->free_elem);
+            }
         }
+      list_push_front (&d->arena_list, &a->desc_elem);
     }
 
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
+  /* Get a block from the first arena's free list and return it. */
+  a = list_entry (list_front (&d->arena_list), struct arena, desc_elem);
+  b = list_entry (list_pop_front (&a->free_list), struct block, free_elem);
+  if (--a->free_cnt == 0)
+    list_remove (&a->desc_elem);
+  count_alloc (d);
   lock_release (&d->lock);
   return b;
 }
@@ -157,6 +271,14 @@ malloc (size_t size)
    Returns a null pointer if memory is not available. */
 void *
 calloc (size_t a, size_t b) 
+{
+  return calloc_at (a, b, NULL);
+}
+
+/* Like calloc(), but records SITE as the place the block was
+   allocated from in MALLOC_TRACE kernels. */
+void *
+calloc_at (size_t a, size_t b, const char *site) 
 {
   void *p;
   size_t size;
@@ -167,7 +289,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = malloc_at (size, site);
   if (p != NULL)
     memset (p, 0, size);
 
@@ -178,11 +300,15 @@ calloc (size_t a, size_t b)
 static size_t
 block_size (void *block) 
 {
+#ifdef MALLOC_TRACE
+  return ((struct tag *) block - 1)->size;
+#else
   struct block *b = block;
   struct arena *a = block_to_arena (b);
   struct desc *d = a->desc;
 
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
+#endif
 }
 
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
@@ -193,6 +319,14 @@ block_size (void *block)
    A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
 void *
 realloc (void *old_block, size_t new_size) 
+{
+  return realloc_at (old_block, new_size, NULL);
+}
+
+/* Like realloc(), but records SITE as the place the new block was
+   allocated from in MALLOC_TRACE kernels. */
+void *
+realloc_at (void *old_block, size_t new_size, const char *site) 
 {
   if (new_size == 0) 
     {
@@ -201,7 +335,7 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = malloc_at (new_size, site);
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -217,6 +351,24 @@ realloc (void *old_block, size_t new_size)
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) 
+{
+#ifdef MALLOC_TRACE
+  if (p != NULL)
+    {
+      struct tag *t = (struct tag *) p - 1;
+      lock_acquire (&tag_lock);
+      list_remove (&t->elem);
+      lock_release (&tag_lock);
+      p = t;
+    }
+#endif
+  free_block (p);
+}
+
+/* Frees block P, which must have been obtained from
+   alloc_block(). */
+static void
+free_block (void *p) 
 {
   if (p != NULL)
     {
@@ -234,35 +386,115 @@ free (void *p)
 #endif
   
           lock_acquire (&d->lock);
+          d->used_cnt--;
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
+          /* Add block to its arena's free list, and the arena to
+             the descriptor's list if it was full. */
+          list_push_front (&a->free_list, &b->free_elem);
+          if (a->free_cnt++ == 0)
+            list_push_front (&d->arena_list, &a->desc_elem);
 
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* If the arena is now entirely unused, keep it as the
+             spare or free it. */
+          if (a->free_cnt >= d->blocks_per_arena) 
             {
-              size_t i;
-
               ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
+              list_remove (&a->desc_elem);
+              if (d->spare == NULL)
                 {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
+                  d->spare = a;
+                  a = NULL;
                 }
-              palloc_free_page (a);
             }
+          else
+            a = NULL;
+          if (a != NULL)
+            d->page_cnt--;
 
           lock_release (&d->lock);
+
+          if (a != NULL)
+            palloc_free_page (a);
         }
       else
         {
           /* It's a big block.  Free its pages. */
+          lock_acquire (&big_desc.lock);
+          big_desc.used_cnt--;
+          big_desc.page_cnt -= a->free_cnt;
+          lock_release (&big_desc.lock);
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
     }
 }
 
+/* Prints malloc() statistics: for each block size in use, the
+   blocks in use now and at most, the requests that succeeded and
+   failed, and the pages held.  In MALLOC_TRACE kernels, also the
+   sites that the blocks still in use were allocated from. */
+void
+malloc_print_stats (void) 
+{
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->alloc_cnt > 0 || d->fail_cnt > 0)
+      printf ("Malloc: %zu-byte blocks: %zu in use, peak %zu, "
+              "%u allocations, %u failures, %zu pages\n",
+              d->block_size, d->used_cnt, d->peak_cnt,
+              d->alloc_cnt, d->fail_cnt, d->page_cnt);
+  d = &big_desc;
+  if (d->alloc_cnt > 0 || d->fail_cnt > 0)
+    printf ("Malloc: big blocks: %zu in use, peak %zu, "
+            "%u allocations, %u failures, %zu pages\n",
+            d->used_cnt, d->peak_cnt, d->alloc_cnt, d->fail_cnt,
+            d->page_cnt);
+
+#ifdef MALLOC_TRACE
+  {
+    struct list_elem *e, *f;
+
+    /* Print each site once, at its first block in the list. */
+    lock_acquire (&tag_lock);
+    for (e = list_begin (&tag_list); e != list_end (&tag_list);
+         e = list_next (e))
+      {
+        struct tag *t = list_entry (e, struct tag, elem);
+        size_t block_cnt = 0, bytes = 0;
+
+        for (f = list_begin (&tag_list); f != e; f = list_next (f))
+          if (!strcmp (list_entry (f, struct tag, elem)->site, t->site))
+            break;
+        if (f != e)
+          continue;
+
+        for (; f != list_end (&tag_list); f = list_next (f))
+          {
+            struct tag *u = list_entry (f, struct tag, elem);
+            if (!strcmp (u->site, t->site))
+              {
+                block_cnt++;
+                bytes += u->size;
+              }
+          }
+        printf ("Malloc: %s: %zu blocks, %zu bytes in use\n",
+                t->site, block_cnt, bytes);
+      }
+    lock_release (&tag_lock);
+  }
+#endif
+}
+
+/* Counts a request that D satisfied.  D's lock must be held. */
+static void
+count_alloc (struct desc *d) 
+{
+  d->alloc_cnt++;
+  if (++d->used_cnt > d->peak_cnt)
+    d->peak_cnt = d->used_cnt;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
@@ -9,5 +9,24 @@ void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_print_stats (void);
+
+/* The same, recording SITE, a "file:line" string, as where the
+   block came from.  Kernels built with MALLOC_TRACE=1 on the make
+   command line keep the site with each block, and the macros
+   below make every call pass the caller's own; otherwise SITE is
+   ignored. */
+void *malloc_at (size_t, const char *site) __attribute__ ((malloc));
+void *calloc_at (size_t, size_t, const char *site) __attribute__ ((malloc));
+void *realloc_at (void *, size_t, const char *site);
+
+#ifdef MALLOC_TRACE
+#define MALLOC_SITE MALLOC_SITE_ (__LINE__)
+#define MALLOC_SITE_(LINE) MALLOC_SITE__ (LINE)
+#define MALLOC_SITE__(LINE) __FILE__ ":" #LINE
+#define malloc(SIZE) malloc_at (SIZE, MALLOC_SITE)
+#define calloc(A, B) calloc_at (A, B, MALLOC_SITE)
+#define realloc(BLOCK, SIZE) realloc_at (BLOCK, SIZE, MALLOC_SITE)
+#endif
 
 #endif /* threads/malloc.h */
@@ -2,13 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,14 +25,73 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are kept by a binary buddy allocator.
+   A free block of order K is 2**K pages long and starts at a
+   page index (counted from the pool's base) that is a multiple
+   of 2**K.  Each order has a list of its free blocks, linked
+   through the first bytes of each block's first page, so finding
+   a run takes O(log n) list operations instead of a scan of the
+   pool.  A request of PAGE_CNT pages splits a block of the
+   smallest sufficient order and hands the unused tail straight
+   back, so any run of allocated pages, not just a whole block,
+   can later be freed; freeing breaks the run into aligned blocks
+   and merges each with its buddy for as long as the buddy is
+   also free.
+
+   The pools are protected by turning interrupts off rather than
+   by a lock, because thread_schedule_tail() frees the page of a
+   dying thread with interrupts already off, where it must not
+   sleep.  Every operation inside is O(log n) per block.
+
+   In front of the pools, each thread keeps a magazine of up to
+   PAGE_MAGAZINE_SIZE free single pages per pool in its struct
+   thread.  Single-page requests and frees, by far the most common
+   ones, push and pop the running thread's magazine and only go to
+   the pool, half a magazine at a time, when it runs empty or
+   full.  A thread returns its magazines when it exits, and a pool
+   that runs out takes back every thread's before giving up.
+
+   When nothing else is ready to run, the idle thread takes free
+   pages out of each pool, zeroes them and keeps up to
+   ZEROED_PAGES of them on the pool's zeroed list, so that
+   single-page PAL_ZERO requests, such as zero-fill page faults,
+   need not zero a page while the caller waits.  Such requests
+   fall back to zeroing a page themselves when the list is empty,
+   and a pool that runs out takes the zeroed pages back too. */
+
+/* Number of block orders.  The largest block is 2**(PALLOC_ORDERS
+   - 1) pages, which is more than any pool holds. */
+#define PALLOC_ORDERS 20
+
+/* Value in a pool's order_map for a page that does not start a
+   free block. */
+#define NOT_FREE 0xff
+
+/* Number of pre-zeroed pages the idle thread keeps per pool. */
+#define ZEROED_PAGES 32
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *order_map;                 /* Order of the free block
+                                           starting at each page. */
+    struct list free_blocks[PALLOC_ORDERS]; /* Free blocks by order. */
     uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+    struct list zeroed;                 /* Free pages already zeroed,
+                                           linked through their first
+                                           bytes. */
+    size_t zeroed_cnt;                  /* Number of pages in ZEROED. */
+
+    /* Statistics, counting pages held by callers, so pages
+       cached in magazines count as free. */
+    size_t used_cnt;                    /* Pages in use. */
+    size_t peak_cnt;                    /* Most pages ever in use. */
+    unsigned alloc_cnt;                 /* Successful requests. */
+    unsigned fail_cnt;                  /* Failed requests. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +100,15 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void *take_pages (struct pool *, size_t page_cnt);
+static void give_pages (struct pool *, void *pages, size_t page_cnt);
+static void *take_cached_page (struct pool *);
+static void give_cached_page (struct pool *, void *page);
+static void *take_zeroed_page (struct pool *);
+static void release_zeroed_pages (struct pool *);
+static void flush_thread (struct thread *, void *aux);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,24 +141,48 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
-  size_t page_idx;
+  enum intr_level old_level;
+  void *pages = NULL;
+  bool zeroed = false;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+  old_level = intr_disable ();
+  if (page_cnt == 1 && (flags & PAL_ZERO))
+    {
+      pages = take_zeroed_page (pool);
+      zeroed = pages != NULL;
+    }
+  if (pages == NULL)
+    {
+      if (page_cnt == 1)
+        pages = take_cached_page (pool);
+      else
+        pages = take_pages (pool, page_cnt);
+    }
+  if (pages == NULL)
+    {
+      /* Other threads may be sitting on free pages, and the
+         zeroed list may hold some. */
+      thread_foreach (flush_thread, NULL);
+      release_zeroed_pages (pool);
+      pages = take_pages (pool, page_cnt);
+    }
+  if (pages != NULL)
+    {
+      pool->alloc_cnt++;
+      pool->used_cnt += page_cnt;
+      if (pool->used_cnt > pool->peak_cnt)
+        pool->peak_cnt = pool->used_cnt;
+    }
   else
-    pages = NULL;
+    pool->fail_cnt++;
+  intr_set_level (old_level);
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -118,7 +212,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
-  size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -131,14 +225,17 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   else
     NOT_REACHED ();
 
-  page_idx = pg_no (pages) - pg_no (pool->base);
-
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  pool->used_cnt -= page_cnt;
+  if (page_cnt == 1)
+    give_cached_page (pool, pages);
+  else
+    give_pages (pool, pages, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +245,103 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the pages cached by the running thread to their
+   pools.  Called by thread_exit(). */
+void
+palloc_flush (void)
+{
+  enum intr_level old_level = intr_disable ();
+  flush_thread (thread_current (), NULL);
+  intr_set_level (old_level);
+}
+
+/* Zeroes one free page ahead of time for a later single-page
+   PAL_ZERO request, if a pool has fewer than ZEROED_PAGES such
+   pages.  The user pool, which serves zero-fill page faults,
+   comes first.  Returns true if a page was zeroed, false if
+   there was nothing to do.  Called by the idle thread. */
+bool
+palloc_zero_ahead (void)
+{
+  struct pool *pools[] = {&user_pool, &kernel_pool};
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+      struct pool *pool = pools[i];
+      enum intr_level old_level;
+      void *page = NULL;
+
+      old_level = intr_disable ();
+      if (pool->zeroed_cnt < ZEROED_PAGES)
+        page = take_pages (pool, 1);
+      intr_set_level (old_level);
+      if (page == NULL)
+        continue;
+
+      /* Zero with interrupts on, so that a thread woken
+         meanwhile can preempt us. */
+      memset (page, 0, PGSIZE);
+
+      old_level = intr_disable ();
+      list_push_front (&pool->zeroed, page);
+      pool->zeroed_cnt++;
+      intr_set_level (old_level);
+      return true;
+    }
+  return false;
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  struct pool *pools[] = {&kernel_pool, &user_pool};
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+      struct pool *p = pools[i];
+      printf ("Palloc: %s: %zu of %zu pages in use, peak %zu, "
+              "%u allocations, %u failures, %zu pages zeroed ahead\n",
+              p->name, p->used_cnt, bitmap_size (p->used_map), p->peak_cnt,
+              p->alloc_cnt, p->fail_cnt, p->zeroed_cnt);
+    }
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and order_map at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
+  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt) + page_cnt,
+                                  PGSIZE);
+  size_t bm_size;
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
+  bm_size = bitmap_buf_size (page_cnt);
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->order_map = (uint8_t *) base + bm_size;
+  memset (p->order_map, NOT_FREE, page_cnt);
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    list_init (&p->free_blocks[order]);
   p->base = base + bm_pages * PGSIZE;
+  p->name = name;
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  free_pages (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +355,222 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the list element kept in the first page of the block
+   at PAGE_IDX in POOL. */
+static struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Puts the free block of the given ORDER at PAGE_IDX on POOL's
+   free list for that order. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order)
+{
+  pool->order_map[page_idx] = order;
+  list_push_front (&pool->free_blocks[order], block_elem (pool, page_idx));
+}
+
+/* Frees the block of the given ORDER at PAGE_IDX in POOL,
+   merging it with its buddy as long as the buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  size_t page_cnt = bitmap_size (pool->used_map);
+
+  for (; order + 1 < PALLOC_ORDERS; order++)
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+      if (buddy_idx >= page_cnt || pool->order_map[buddy_idx] != order)
+        break;
+      list_remove (block_elem (pool, buddy_idx));
+      pool->order_map[buddy_idx] = NOT_FREE;
+      page_idx &= ~((size_t) 1 << order);
+    }
+  push_block (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in POOL, as the
+   largest aligned blocks that cover them. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+      while (order + 1 < PALLOC_ORDERS
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Takes PAGE_CNT contiguous free pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t page_idx;
+  int want, order;
+
+  for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+    if (want + 1 >= PALLOC_ORDERS)
+      return BITMAP_ERROR;
+
+  for (order = want; order < PALLOC_ORDERS; order++)
+    if (!list_empty (&pool->free_blocks[order]))
+      break;
+  if (order >= PALLOC_ORDERS)
+    return BITMAP_ERROR;
+
+  e = list_pop_front (&pool->free_blocks[order]);
+  page_idx = pg_no (e) - pg_no (pool->base);
+  pool->order_map[page_idx] = NOT_FREE;
+
+  /* Split off the upper halves we don't need, then give back
+     whatever is left past PAGE_CNT. */
+  while (order > want)
+    {
+      order--;
+      push_block (pool, page_idx + ((size_t) 1 << order), order);
+    }
+  free_pages (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL itself and returns
+   the first, or a null pointer if there are not enough.
+   Interrupts must be off. */
+static void *
+take_pages (struct pool *pool, size_t page_cnt)
+{
+  size_t page_idx = alloc_pages (pool, page_cnt);
+
+  if (page_idx == BITMAP_ERROR)
+    return NULL;
+  ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+  return pool->base + PGSIZE * page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGES to POOL itself.
+   Interrupts must be off. */
+static void
+give_pages (struct pool *pool, void *pages, size_t page_cnt)
+{
+  size_t page_idx = pg_no (pages) - pg_no (pool->base);
+
+  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_pages (pool, page_idx, page_cnt);
+}
+
+/* Returns thread T's magazine for POOL. */
+static struct page_magazine *
+magazine_of (struct thread *t, const struct pool *pool)
+{
+  return &t->magazines[pool == &user_pool];
+}
+
+/* Takes a page from the running thread's magazine for POOL,
+   first refilling the magazine with half its capacity if it is
+   empty.  Returns a null pointer if POOL has no pages either.
+   Interrupts must be off. */
+static void *
+take_cached_page (struct pool *pool)
+{
+  struct page_magazine *m = magazine_of (thread_current (), pool);
+
+  if (m->cnt == 0)
+    {
+      /* Prefer one contiguous run, which costs a single split. */
+      uint8_t *run = take_pages (pool, PAGE_MAGAZINE_SIZE / 2);
+      if (run != NULL)
+        {
+          size_t i;
+          for (i = PAGE_MAGAZINE_SIZE / 2; i-- > 0; )
+            m->pages[m->cnt++] = run + PGSIZE * i;
+        }
+      else
+        {
+          void *page;
+          while (m->cnt < PAGE_MAGAZINE_SIZE / 2
+                 && (page = take_pages (pool, 1)) != NULL)
+            m->pages[m->cnt++] = page;
+        }
+      if (m->cnt == 0)
+        return NULL;
+    }
+  return m->pages[--m->cnt];
+}
+
+/* Puts PAGE, which belongs to POOL, in the running thread's
+   magazine, first returning the older half of the magazine to
+   POOL if it is full.  Interrupts must be off. */
+static void
+give_cached_page (struct pool *pool, void *page)
+{
+  struct page_magazine *m = magazine_of (thread_current (), pool);
+
+  if (m->cnt == PAGE_MAGAZINE_SIZE)
+    {
+      size_t i;
+
+      for (i = 0; i < PAGE_MAGAZINE_SIZE / 2; i++)
+        give_pages (pool, m->pages[i], 1);
+      m->cnt -= PAGE_MAGAZINE_SIZE / 2;
+      memmove (m->pages, m->pages + PAGE_MAGAZINE_SIZE / 2,
+               sizeof *m->pages * m->cnt);
+    }
+  m->pages[m->cnt++] = page;
+}
+
+/* Returns all of thread T's cached pages to their pools.
+   Interrupts must be off. */
+static void
+flush_thread (struct thread *t, void *aux UNUSED)
+{
+  struct pool *pools[] = {&kernel_pool, &user_pool};
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+      struct page_magazine *m = magazine_of (t, pools[i]);
+      while (m->cnt > 0)
+        give_pages (pools[i], m->pages[--m->cnt], 1);
+    }
+}
+
+/* Takes a page from POOL's zeroed list and returns it, or a null
+   pointer if the list is empty.  Interrupts must be off. */
+static void *
+take_zeroed_page (struct pool *pool)
+{
+  struct list_elem *e;
+
+  if (list_empty (&pool->zeroed))
+    return NULL;
+  e = list_pop_front (&pool->zeroed);
+  pool->zeroed_cnt--;
+
+  /* Clear the list element, the only part that is not zero. */
+  memset (e, 0, sizeof *e);
+  return e;
+}
+
+/* Returns all of the pages on POOL's zeroed list to POOL.
+   Interrupts must be off. */
+static void
+release_zeroed_pages (struct pool *pool)
+{
+  while (!list_empty (&pool->zeroed))
+    give_pages (pool, list_pop_front (&pool->zeroed), 1);
+  pool->zeroed_cnt = 0;
+}
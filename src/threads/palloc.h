@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,25 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Number of free pages a thread may keep from each pool. */
+#define PAGE_MAGAZINE_SIZE 8
+
+/* Free single pages kept by one thread for one pool, so that
+   palloc_get_page() and palloc_free_page() can usually skip the
+   pool's buddy allocator.  Owned by palloc.c. */
+struct page_magazine
+  {
+    size_t cnt;                         /* Number of pages held. */
+    void *pages[PAGE_MAGAZINE_SIZE];    /* Pages, last freed on top. */
+  };
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_flush (void);
+bool palloc_zero_ahead (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
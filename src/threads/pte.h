@@ -66,6 +66,16 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100             /* 1=global, kept in TLB across CR3 loads. */
+
+/* A PDE with PTE_PS set maps a whole PTSPAN-byte (4 MB) large
+   page instead of pointing to a page table.  The large page's
+   physical address must be PTSPAN-aligned and only bits 22:31
+   hold it.  Large PDEs also carry the accessed and dirty bits
+   for the whole large page.  They require the PSE bit in CR4;
+   see [IA32-v3a] 3.7.3 "Mixing 4-KByte and 4-MByte Pages". */
+#define PDE_LARGE_ADDR 0xffc00000 /* Address bits of a large PDE. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -77,9 +87,37 @@ static inline uint32_t pde_create (uint32_t *pt) {
    PDE, which must "present", points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!(pde & PTE_PS));
   return ptov (pde & PTE_ADDR);
 }
 
+/* Returns true if PDE is present and maps a large page. */
+static inline bool pde_is_large (uint32_t pde) {
+  return (pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
+/* Returns a large PDE that maps the PTSPAN bytes starting at
+   PAGE, which must be PTSPAN-aligned in physical memory.
+   If WRITABLE is true the large page is writable as well as
+   readable.  It is usable only by ring 0 code (the kernel). */
+static inline uint32_t pde_create_large_kernel (void *page, bool writable) {
+  ASSERT ((vtop (page) & ~PDE_LARGE_ADDR) == 0);
+  return vtop (page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
+/* Returns a large PDE like pde_create_large_kernel(), but usable
+   by both user and kernel code. */
+static inline uint32_t pde_create_large_user (void *page, bool writable) {
+  return pde_create_large_kernel (page, writable) | PTE_U;
+}
+
+/* Returns a pointer to the first byte of the large page that
+   large PDE points to. */
+static inline void *pde_get_large_page (uint32_t pde) {
+  ASSERT (pde_is_large (pde));
+  return ptov (pde & PDE_LARGE_ADDR);
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
@@ -0,0 +1,221 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator for kernel objects that are created and
+   destroyed often, all at one size.
+
+   malloc() rounds every request up to a power of 2, so a 20-byte
+   object takes a 32-byte block, and all objects of similar size
+   share one descriptor and its lock.  A slab cache instead packs
+   objects of exactly its own size (rounded up only to pointer
+   alignment) into pages of its own, and has its own lock.
+
+   Each slab is one page from the kernel pool, with a struct slab
+   at its start and the objects after it.  Free objects in a slab
+   are linked through their first word.  The cache allocates from
+   the slabs on its partial list first, so that objects are packed
+   into as few pages as possible.  A slab whose last object is
+   freed is kept as the cache's spare, and only a second one is
+   given back to the page allocator, so that a cache that keeps
+   allocating and freeing one object does not get and free a page
+   every time. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab0bec
+
+/* Header at the start of each slab. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's partial or full. */
+    size_t used_cnt;            /* Objects in use. */
+    void *free;                 /* First free object. */
+  };
+
+/* All caches, for slab_print_stats().  Caches are only created
+   while the kernel boots, so the list needs no lock. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *new_slab (struct slab_cache *);
+
+/* Initializes cache C for objects of OBJ_SIZE bytes, named NAME
+   for debugging purposes.  If CTOR is nonnull, it is called on
+   each object that slab_alloc() returns. */
+void
+slab_cache_init (struct slab_cache *c, const char *name, size_t obj_size,
+                 slab_ctor *ctor)
+{
+  ASSERT (obj_size > 0);
+
+  if (obj_size < sizeof (void *))
+    obj_size = sizeof (void *);
+  c->name = name;
+  c->obj_size = ROUND_UP (obj_size, sizeof (void *));
+  c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / c->obj_size;
+  ASSERT (c->objs_per_slab > 0);
+  c->ctor = ctor;
+  lock_init (&c->lock);
+  list_init (&c->partial);
+  list_init (&c->full);
+  c->empty = NULL;
+  c->slab_cnt = 0;
+  c->used_cnt = c->peak_cnt = 0;
+  c->alloc_cnt = c->fail_cnt = 0;
+  list_push_back (&all_caches, &c->elem);
+}
+
+/* Obtains and returns an object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *c)
+{
+  struct slab *s;
+  void **obj;
+
+  lock_acquire (&c->lock);
+
+  /* Take a slab with free objects, using the spare or a new one
+     only if no partly used slab is left. */
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else
+    {
+      if (c->empty != NULL)
+        {
+          s = c->empty;
+          c->empty = NULL;
+        }
+      else
+        {
+          s = new_slab (c);
+          if (s == NULL)
+            {
+              c->fail_cnt++;
+              lock_release (&c->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Take its first free object. */
+  obj = s->free;
+  s->free = *obj;
+  if (++s->used_cnt == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  c->alloc_cnt++;
+  if (++c->used_cnt > c->peak_cnt)
+    c->peak_cnt = c->used_cnt;
+
+  lock_release (&c->lock);
+
+  if (c->ctor != NULL)
+    c->ctor (obj);
+  return obj;
+}
+
+/* Returns object OBJ, which must have been obtained from cache C
+   with slab_alloc(), to C. */
+void
+slab_free (struct slab_cache *c, void *obj_)
+{
+  void **obj = obj_;
+  struct slab *s, *unused = NULL;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+  ASSERT ((pg_ofs (obj) - sizeof *s) % c->obj_size == 0);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+
+  *obj = s->free;
+  s->free = obj;
+  c->used_cnt--;
+  if (s->used_cnt-- == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Keep one wholly free slab as the spare and free any other. */
+  if (s->used_cnt == 0)
+    {
+      list_remove (&s->elem);
+      if (c->empty == NULL)
+        c->empty = s;
+      else
+        {
+          c->slab_cnt--;
+          unused = s;
+        }
+    }
+
+  lock_release (&c->lock);
+
+  if (unused != NULL)
+    palloc_free_page (unused);
+}
+
+/* Prints statistics for each slab cache that has been used. */
+void
+slab_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+      if (c->alloc_cnt > 0 || c->fail_cnt > 0)
+        printf ("Slab: %s: %zu in use, peak %zu, %u allocations, "
+                "%u failures, %zu pages\n",
+                c->name, c->used_cnt, c->peak_cnt, c->alloc_cnt,
+                c->fail_cnt, c->slab_cnt);
+    }
+}
+
+/* Obtains a page for cache C and carves it into free objects.
+   Returns a null pointer if memory is not available. */
+static struct slab *
+new_slab (struct slab_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  uint8_t *obj;
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->used_cnt = 0;
+  s->free = NULL;
+  obj = (uint8_t *) (s + 1) + c->obj_size * c->objs_per_slab;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      obj -= c->obj_size;
+      *(void **) obj = s->free;
+      s->free = obj;
+    }
+  c->slab_cnt++;
+  return s;
+}
@@ -0,0 +1,39 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Prepares an object just taken from a cache. */
+typedef void slab_ctor (void *obj);
+
+/* A cache of objects of a single size.  Each page ("slab") the
+   cache owns is carved into as many objects as fit. */
+struct slab_cache
+  {
+    const char *name;           /* Name, for debugging. */
+    size_t obj_size;            /* Bytes per object, rounded up. */
+    size_t objs_per_slab;       /* Objects carved from each slab. */
+    slab_ctor *ctor;            /* Called on each object handed out. */
+    struct lock lock;           /* Protects the members below. */
+    struct list partial;        /* Slabs with objects in use and free. */
+    struct list full;           /* Slabs with every object in use. */
+    struct slab *empty;         /* A slab with no objects in use. */
+    size_t slab_cnt;            /* Slabs held, counting EMPTY. */
+
+    /* Statistics. */
+    size_t used_cnt;            /* Objects in use. */
+    size_t peak_cnt;            /* Most objects ever in use. */
+    unsigned alloc_cnt;         /* Successful requests. */
+    unsigned fail_cnt;          /* Failed requests. */
+    struct list_elem elem;      /* Element in the list of all caches. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name,
+                      size_t obj_size, slab_ctor *);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -193,7 +193,9 @@ thread_create (const char *name, int priority,
   tid = t->tid = allocate_tid ();
 
 #ifdef USERPROG
-  list_init(&t->open_fd);
+  t->fd_table = NULL;
+  t->fd_map = NULL;
+  t->fd_cnt = 0;
   t->executable = NULL;
   t->process = NULL;
   // t->process->exit_status = -1;
@@ -314,6 +316,7 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  palloc_flush ();
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -422,6 +425,16 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else is ready, so zero free pages for later
+         PAL_ZERO requests, one page at a time, until a thread
+         becomes ready or there is nothing left to zero. */
+      intr_enable ();
+      while (list_empty (&ready_list) && palloc_zero_ahead ())
+        continue;
+      intr_disable ();
+      if (!list_empty (&ready_list))
+        continue;
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
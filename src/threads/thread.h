@@ -3,7 +3,9 @@
 
 #include <debug.h>
 #include <list.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "threads/palloc.h"
 
 #ifdef VM
 #include "vm/page.h"
@@ -97,12 +99,17 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by palloc.c. */
+    struct page_magazine magazines[2];  /* Free pages from the kernel
+                                           and user pools. */
 
 #ifdef USERPROG
     /* Owned by process.c */
     struct process *process;            /* Stores process information */
 
-    struct list open_fd;                /* List of open file descriptors. */
+    struct file **fd_table;             /* Open files, indexed by file descriptor. */
+    struct bitmap *fd_map;              /* File descriptors in use. */
+    size_t fd_cnt;                      /* Number of slots in fd_table and fd_map. */
 
     struct file *executable;            /* This process' executable file. */
 
@@ -116,6 +123,14 @@ struct thread
     struct list mmap_list;                     /* Memory mapped files. */
 
     uint32_t esp;  /* Stores the stack pointer, in case page fault occurs in the kernel. */
+
+    /* Owned by vm/frame.c. */
+    size_t resident_frames;                    /* Frames currently held. */
+    size_t working_set;                        /* Frames referenced in the last sample window. */
+    unsigned page_faults;                      /* Pages brought into frames in total. */
+    unsigned window_faults;                    /* Pages brought in during the current window. */
+    unsigned fault_rate;                       /* Pages brought in during the last window. */
+    unsigned ws_epoch;                         /* Sample window the fields above refer to. */
 #endif
 
     /* Owned by thread.c. */
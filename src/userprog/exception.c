@@ -7,6 +7,7 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/process.h"
+#include "userprog/usercopy.h"
 #include "vm/page.h"
 #include "vm/frame.h"
 
@@ -15,7 +16,7 @@ static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
-static void page_fault_error (bool user, struct intr_frame *f);
+static void page_fault_error (bool user, void *fault_addr, struct intr_frame *f);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -126,7 +127,6 @@ static void
 page_fault (struct intr_frame *f) 
 {
   bool not_present;  /* True: not-present page, false: writing r/o page. */
-  bool write;        /* True: access was write, false: access was read. */
   bool user;         /* True: access by user, false: access by kernel. */
   void *fault_addr;  /* Fault address. */
 
@@ -148,7 +148,6 @@ page_fault (struct intr_frame *f)
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
-  write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
    // page_fault_error (user, f);
@@ -159,7 +158,8 @@ page_fault (struct intr_frame *f)
 
    if (!not_present)
    {
-      page_fault_error (user, f);
+      page_fault_error (user, fault_addr, f);
+      return;
    }
    struct page *page = find_page(t->supp_page_table, fault_page);
    
@@ -180,18 +180,15 @@ page_fault (struct intr_frame *f)
 
    if(!page) 
    {
-      page_fault_error (user, f);
+      page_fault_error (user, fault_addr, f);
+      return;
    }
 
 
    if (!load_page(page, t->pagedir, fault_page))
    {
-      page_fault_error (user, f);
-      printf ("Page fault at %p: %s error %s page in %s context.\n",
-         fault_addr,
-         not_present ? "not present" : "rights violation",
-         write ? "writing" : "reading",
-         user ? "user" : "kernel");
+      page_fault_error (user, fault_addr, f);
+      return;
    }
    set_used (page->faddress, false);
    
@@ -199,16 +196,17 @@ page_fault (struct intr_frame *f)
 }
 
 
-static void page_fault_error (bool user, struct intr_frame *f)
+static void page_fault_error (bool user, void *fault_addr, struct intr_frame *f)
 {
-   thread_current()->process->exit_status = -1;
-  /* A page fault in the kernel merely sets the interupt 
-     frame eax to 0xffffffff and copies the old value into eip. */
-  if (!user) 
+  /* A page fault in the kernel while copying to or from user
+     memory ends the copy early, and the system call decides
+     what to do with the bad pointer. */
+  if (!user && is_user_vaddr (fault_addr) && usercopy_fixup (f))
   {
-    f->eip = (void *) f->eax;
-    f->eax = 0xffffffff;
+    return;
   }
+
+   thread_current()->process->exit_status = -1;
    exit_exception();
 
 //   /* To implement virtual memory, delete the rest of the function
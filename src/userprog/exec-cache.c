@@ -0,0 +1,112 @@
+#include "userprog/exec-cache.h"
+#include <debug.h>
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "userprog/syscall.h"
+
+/* Cache of parsed executables.
+
+   Every exec used to read and validate the ELF header and all of
+   the program headers of its executable again.  Instead, load()
+   looks the executable's inode up here and, on a hit, only has to
+   build the supplemental page table from the cached segments.
+
+   Each entry keeps its inode open, so that the inode, and with it
+   its version, stays in memory for as long as the entry exists.
+   A write to the executable changes the version, which makes the
+   entry stale.  Keeping the inode open also means that a removed
+   executable's sectors are not freed until its entry is evicted,
+   which is why the cache is small.
+
+   The cache is only used with filesys_lock held, which is what
+   protects it. */
+
+/* Number of cached executables. */
+#define EXEC_CACHE_SIZE 8
+
+/* A cached executable. */
+struct exec_cache_entry
+  {
+    struct inode *inode;        /* Executable, or a null pointer if unused. */
+    unsigned version;           /* inode_version() when it was parsed. */
+    unsigned last_used;         /* Value of clock at the last hit. */
+    struct exec_image image;    /* Parsed executable. */
+  };
+
+static struct exec_cache_entry cache[EXEC_CACHE_SIZE];
+static unsigned clock;
+
+static void evict (struct exec_cache_entry *);
+
+/* Returns the cached image of the executable INODE, or a null
+   pointer if it is not cached or was written since it was cached.
+   The image remains valid until filesys_lock is released. */
+const struct exec_image *
+exec_cache_lookup (struct inode *inode)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&filesys_lock));
+
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    {
+      struct exec_cache_entry *e = &cache[i];
+      if (e->inode != inode)
+        continue;
+
+      if (e->version != inode_version (inode))
+        {
+          evict (e);
+          return NULL;
+        }
+      e->last_used = ++clock;
+      return &e->image;
+    }
+  return NULL;
+}
+
+/* Adds IMAGE, the parsed executable INODE, to the cache, evicting
+   the least recently used entry if the cache is full.  The cache
+   takes ownership of IMAGE's segment array.  Returns the cached
+   copy of IMAGE, which remains valid until filesys_lock is
+   released. */
+const struct exec_image *
+exec_cache_insert (struct inode *inode, const struct exec_image *image)
+{
+  struct exec_cache_entry *victim = &cache[0];
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&filesys_lock));
+
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    {
+      struct exec_cache_entry *e = &cache[i];
+      if (e->inode == inode || e->inode == NULL)
+        {
+          victim = e;
+          break;
+        }
+      if (e->last_used < victim->last_used)
+        victim = e;
+    }
+
+  evict (victim);
+  victim->inode = inode_reopen (inode);
+  victim->version = inode_version (inode);
+  victim->last_used = ++clock;
+  victim->image = *image;
+  return &victim->image;
+}
+
+/* Drops entry E from the cache, if it is in use. */
+static void
+evict (struct exec_cache_entry *e)
+{
+  if (e->inode == NULL)
+    return;
+
+  inode_close (e->inode);
+  free (e->image.segments);
+  e->inode = NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef USERPROG_EXEC_CACHE_H
+#define USERPROG_EXEC_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct inode;
+
+/* A loadable segment of an executable, already validated and
+   rounded out to whole pages. */
+struct exec_segment
+  {
+    uint32_t file_page;         /* Offset in the file of the first page. */
+    uint32_t mem_page;          /* User virtual address of the first page. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after those read. */
+    bool writable;              /* Whether the pages are writable. */
+  };
+
+/* The parts of an executable that load() needs to start a process
+   from it. */
+struct exec_image
+  {
+    void (*entry) (void);       /* Entry point. */
+    size_t segment_cnt;         /* Number of loadable segments. */
+    struct exec_segment *segments;  /* Array of SEGMENT_CNT, from malloc(). */
+  };
+
+const struct exec_image *exec_cache_lookup (struct inode *);
+const struct exec_image *exec_cache_insert (struct inode *,
+                                            const struct exec_image *);
+
+#endif /* userprog/exec-cache.h */
@@ -37,7 +37,9 @@ gdt_init (void)
 {
   uint64_t gdtr_operand;
 
-  /* Initialize GDT. */
+  /* Initialize GDT.  SYSENTER and SYSEXIT derive the kernel data
+     and user selectors from SEL_KCSEG, so the four code and data
+     segments must stay in this order. */
   gdt[SEL_NULL / sizeof *gdt] = 0;
   gdt[SEL_KCSEG / sizeof *gdt] = make_code_desc (0);
   gdt[SEL_KDSEG / sizeof *gdt] = make_data_desc (0);
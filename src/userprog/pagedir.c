@@ -5,9 +5,24 @@
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
 
+/* Page directories of exited processes that are waiting to be
+   destroyed by the reaper thread.  The kernel half of a retired
+   page directory is never used again, so the list is threaded
+   through the last entry of each directory. */
+static uint32_t *retired_pds;
+static struct lock retired_lock;
+static struct semaphore retired_sema;
+static bool reaper_started;
+
+#define RETIRED_NEXT(PD) ((PD)[PGSIZE / sizeof (uint32_t) - 1])
+
+static thread_func reaper;
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+static uint32_t *lookup_entry (uint32_t *pd, const void *vaddr);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -17,16 +32,22 @@ uint32_t *
 pagedir_create (void) 
 {
   uint32_t *pd = palloc_get_page (0);
+  if (pd == NULL && pagedir_reap ())
+    pd = palloc_get_page (0);
   if (pd != NULL)
     memcpy (pd, init_page_dir, PGSIZE);
   return pd;
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references.  Physically contiguous pages are handed back to
+   the page allocator in a single call, and so is each large
+   page. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
+  uint8_t *run = NULL;
+  size_t run_cnt = 0;
   uint32_t *pde;
 
   if (pd == NULL)
@@ -34,19 +55,106 @@ pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+    if (pde_is_large (*pde))
+      palloc_free_multiple (pde_get_large_page (*pde), PTSPAN / PGSIZE);
+    else if (*pde & PTE_P) 
       {
         uint32_t *pt = pde_get_pt (*pde);
         uint32_t *pte;
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            {
+              uint8_t *page = pte_get_page (*pte);
+              if (run_cnt > 0 && page == run + run_cnt * PGSIZE)
+                run_cnt++;
+              else
+                {
+                  palloc_free_multiple (run, run_cnt);
+                  run = page;
+                  run_cnt = 1;
+                }
+            }
         palloc_free_page (pt);
       }
+  palloc_free_multiple (run, run_cnt);
   palloc_free_page (pd);
 }
 
+/* Starts a thread that destroys the page directories passed to
+   pagedir_retire(), so that exiting processes do not have to
+   wait for their pages to be freed. */
+void
+pagedir_start_reaper (void) 
+{
+  lock_init (&retired_lock);
+  sema_init (&retired_sema, 0);
+  reaper_started = thread_create ("reaper", PRI_DEFAULT,
+                                  reaper, NULL) != TID_ERROR;
+}
+
+/* Destroys page directory PD, which must not be active.  If the
+   reaper thread is running, PD is destroyed later by the reaper
+   instead. */
+void
+pagedir_retire (uint32_t *pd) 
+{
+  if (pd == NULL)
+    return;
+
+  ASSERT (!pagedir_is_active (pd));
+  if (!reaper_started) 
+    {
+      pagedir_destroy (pd);
+      return;
+    }
+
+  lock_acquire (&retired_lock);
+  RETIRED_NEXT (pd) = (uint32_t) retired_pds;
+  retired_pds = pd;
+  lock_release (&retired_lock);
+  sema_up (&retired_sema);
+}
+
+/* Destroys every page directory waiting for the reaper thread.
+   Returns true if any page directory was destroyed, false
+   otherwise. */
+bool
+pagedir_reap (void) 
+{
+  uint32_t *pd;
+
+  if (!reaper_started)
+    return false;
+
+  lock_acquire (&retired_lock);
+  pd = retired_pds;
+  retired_pds = NULL;
+  lock_release (&retired_lock);
+
+  if (pd == NULL)
+    return false;
+  while (pd != NULL) 
+    {
+      uint32_t *next = (uint32_t *) RETIRED_NEXT (pd);
+      pagedir_destroy (pd);
+      pd = next;
+    }
+  return true;
+}
+
+/* Reaper thread.  Destroys retired page directories as they
+   arrive. */
+static void
+reaper (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      sema_down (&retired_sema);
+      pagedir_reap ();
+    }
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -85,6 +193,22 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
   return &pt[pt_no (vaddr)];
 }
 
+/* Returns the entry that holds the flags for virtual address
+   VADDR in page directory PD: the user large PDE if VADDR is a
+   user address in a large page, otherwise its page table entry.
+   Kernel addresses always go to lookup_page(), because the
+   accessed and dirty bits of a large kernel PDE describe all of
+   its 4 MB rather than any one page.  Returns a null pointer if
+   PD has neither. */
+static uint32_t *
+lookup_entry (uint32_t *pd, const void *vaddr)
+{
+  uint32_t *pde = pd + pd_no (vaddr);
+  if (is_user_vaddr (vaddr) && pde_is_large (*pde))
+    return pde;
+  return lookup_page (pd, vaddr, false);
+}
+
 /* Adds a mapping in page directory PD from user virtual page
    UPAGE to the physical frame identified by kernel virtual
    address KPAGE.
@@ -118,6 +242,37 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/* Adds a large page mapping in page directory PD from the
+   PTSPAN-byte (4 MB) user virtual region starting at UPAGE to the
+   physically contiguous memory starting at kernel virtual
+   address KPAGE.  Both must be PTSPAN-aligned, and KPAGE should
+   be PTSPAN / PGSIZE pages obtained from the user pool with
+   palloc_get_multiple(); pagedir_destroy() frees them that way.
+   The region is always resident: it cannot be evicted one page
+   at a time.
+   If WRITABLE is true, the new region is read/write; otherwise
+   it is read-only.
+   Returns true if successful, false if the CPU does not support
+   large pages or if part of the region already has a page
+   table. */
+bool
+pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+  uint32_t *pde;
+
+  ASSERT ((uintptr_t) upage % PTSPAN == 0);
+  ASSERT (vtop (kpage) % PTSPAN == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (vtop (kpage) / PGSIZE + PTSPAN / PGSIZE <= init_ram_pages);
+  ASSERT (pd != init_page_dir);
+
+  pde = pd + pd_no (upage);
+  if (!init_large_pages || *pde != 0)
+    return false;
+  *pde = pde_create_large_user (kpage, writable);
+  return true;
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -128,7 +283,11 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
   uint32_t *pte;
 
   ASSERT (is_user_vaddr (uaddr));
-  
+
+  pte = pd + pd_no (uaddr);
+  if (pde_is_large (*pte))
+    return pde_get_large_page (*pte) + ((uintptr_t) uaddr & (PTSPAN - 1));
+
   pte = lookup_page (pd, uaddr, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
     return pte_get_page (*pte) + pg_ofs (uaddr);
@@ -152,18 +311,19 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
-   installed.
+   installed.  If VPAGE is a user page in a large page, the
+   dirty bit is the large PDE's and covers the whole large page.
    Returns false if PD contains no PTE for VPAGE. */
 bool
 pagedir_is_dirty (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pte = lookup_entry (pd, vpage);
   return pte != NULL && (*pte & PTE_D) != 0;
 }
 
@@ -172,7 +332,7 @@ pagedir_is_dirty (uint32_t *pd, const void *vpage)
 void
 pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pte = lookup_entry (pd, vpage);
   if (pte != NULL) 
     {
       if (dirty)
@@ -180,19 +340,21 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PD has been
    accessed recently, that is, between the time the PTE was
-   installed and the last time it was cleared.  Returns false if
-   PD contains no PTE for VPAGE. */
+   installed and the last time it was cleared.  If VPAGE is a
+   user page in a large page, the accessed bit is the large
+   PDE's and covers the whole large page.  Returns false if PD
+   contains no PTE for VPAGE. */
 bool
 pagedir_is_accessed (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pte = lookup_entry (pd, vpage);
   return pte != NULL && (*pte & PTE_A) != 0;
 }
 
@@ -201,7 +363,7 @@ pagedir_is_accessed (uint32_t *pd, const void *vpage)
 void
 pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pte = lookup_entry (pd, vpage);
   if (pte != NULL) 
     {
       if (accessed)
@@ -209,7 +371,7 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -230,6 +392,14 @@ pagedir_activate (uint32_t *pd)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
+/* Returns true if PD, or the kernel-only page directory if PD is
+   a null pointer, is the active page directory. */
+bool
+pagedir_is_active (uint32_t *pd) 
+{
+  return active_pd () == (pd != NULL ? pd : init_page_dir);
+}
+
 /* Returns the currently active page directory. */
 static uint32_t *
 active_pd (void) 
@@ -245,19 +415,20 @@ active_pd (void)
 
 /* Some page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the changed page.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for VADDR if PD is the
+   active page directory.  (If PD is not active then its user
+   entries are not in the TLB, so there is no need to invalidate
+   anything.)  Kernel mappings are shared by every page directory
+   and are global, so a reload of CR3 would not drop them; their
+   entries are always invalidated.  INVLPG removes a single entry,
+   global or not, and leaves the rest of the TLB intact.  See
+   [IA32-v3a] 3.12 "Translation Lookaside Buffers (TLBs)". */
 static void
-invalidate_pagedir (uint32_t *pd) 
+invalidate_page (uint32_t *pd, const void *vaddr) 
 {
-  if (active_pd () == pd) 
-    {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
-    } 
+  if (!is_user_vaddr (vaddr) || active_pd () == pd) 
+    asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
 }
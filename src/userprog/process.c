@@ -7,9 +7,12 @@
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/exec-cache.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
@@ -26,75 +29,131 @@
 static thread_func start_process NO_RETURN;
 static bool load (const char *file_name, char *args, void (**eip) (void), void **esp);
 static bool push_arguments (void **esp, const char *file_name, char *args);
-static void init_process(struct process *parent);
+static tid_t start_child (const char *cmd_line, bool wait_load);
+static struct process *init_process(struct process *parent);
 static struct process *get_child_process(struct list *child_list, pid_t child_pid);
 static void notify_child_process(struct list *child_list);
 static void free_process(struct process *process);
 
+/* Passed from the parent to start_process() at the start of the
+   page that also holds the command line. */
 struct process_info
 {
   char *process_name;
   char *process_args;
-  struct process *parent;
-  struct semaphore *wait_load;
-  bool load_success;
+  struct process *process;      /* The child, owned by the parent. */
+  struct semaphore *loaded;     /* Upped after load(), if not null. */
 };
 
+/* Cache the process records are allocated from. */
+static struct slab_cache process_cache;
+
+/* Initializes the process module. */
+void
+process_init (void)
+{
+  slab_cache_init (&process_cache, "process", sizeof (struct process), NULL);
+}
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   thread id, or TID_ERROR if the thread cannot be created or the
+   program cannot be loaded. */
 tid_t
 process_execute (const char *cmd_line) 
 {
+  return start_child (cmd_line, true);
+}
+
+/* Like process_execute(), but returns as soon as the new thread
+   exists, without waiting for the program to be loaded, so that a
+   parent can start many children whose loads overlap.  If the
+   program cannot be loaded, the child exits with status -1, which
+   the parent sees through process_wait(). */
+tid_t
+process_spawn (const char *cmd_line)
+{
+  return start_child (cmd_line, false);
+}
+
+/* Starts a child of the current process running CMD_LINE, and if
+   WAIT_LOAD, waits until it has been loaded.  Returns its thread
+   id, or TID_ERROR on failure. */
+static tid_t
+start_child (const char *cmd_line, bool wait_load)
+{
+  struct process_info *process_info;
+  struct process *child;
+  struct semaphore loaded;
   char *cl_copy;
   tid_t tid;
-  
-  /* Make a copy of CMD_LINE.
+
+  if (thread_current()->process == NULL) 
+    thread_current()->process = init_process(NULL);
+
+  /* Make a copy of CMD_LINE after the process_info, in a page
+     that the child frees once loaded.
      Otherwise there's a race between the caller and load(). */
-  cl_copy = palloc_get_page (0);
-  if (cl_copy == NULL)
+  process_info = palloc_get_page (0);
+  if (process_info == NULL)
     return TID_ERROR;
-  strlcpy (cl_copy, cmd_line, PGSIZE);
+  cl_copy = (char *) (process_info + 1);
+  strlcpy (cl_copy, cmd_line, PGSIZE - sizeof *process_info);
+
+  /* The child's process record exists before the child runs, so
+     that the parent can wait for it as soon as we return. */
+  child = init_process(thread_current()->process);
+  if (child == NULL)
+  {
+    palloc_free_page (process_info);
+    return TID_ERROR;
+  }
 
-  if (thread_current()->process == NULL) 
-    init_process(NULL);
-  
-  struct process_info process_info;
-  // process_info.command_line = cl_copy;
-  process_info.parent = thread_current()->process;
-  
   char *null_pointer;
   char *prog_name = strtok_r(cl_copy, " ", &null_pointer);
-  process_info.process_name = prog_name;
-  process_info.process_args = null_pointer;
-  process_info.wait_load = malloc(sizeof(struct semaphore));
-  sema_init(process_info.wait_load, 0);
+  process_info->process_name = prog_name;
+  process_info->process_args = null_pointer;
+  process_info->process = child;
+  process_info->loaded = NULL;
+  if (wait_load)
+  {
+    sema_init(&loaded, 0);
+    process_info->loaded = &loaded;
+  }
 
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (prog_name, PRI_DEFAULT, start_process, &process_info);
+  tid = thread_create (prog_name, PRI_DEFAULT, start_process, process_info);
   if (tid == TID_ERROR) {
-    palloc_free_page (cl_copy); 
-    free(process_info.wait_load);
+    palloc_free_page (process_info); 
+    free_process(child);
     return tid;
   }
-  
-  sema_down(process_info.wait_load);
-  free(process_info.wait_load);
-  if (!process_info.load_success)
-    return TID_ERROR;
+  child->pid = tid;
+
+  if (wait_load)
+  {
+    sema_down(&loaded);
+    if (!child->loaded)
+      return TID_ERROR;
+  }
   return tid;
 }
 
-static void init_process(struct process *parent)
+/* Allocates the process record of a child of PARENT, or of the
+   initial process if PARENT is a null pointer.
+   Returns a null pointer if out of memory. */
+static struct process *init_process(struct process *parent)
 {
-  struct process *child = malloc(sizeof(struct process));
-  child->wait_child = malloc(sizeof(struct semaphore));
+  struct process *child = slab_alloc(&process_cache);
+  if (child == NULL)
+    return NULL;
   child->pid = thread_current()->tid;
   child->exit_status = TID_ERROR;
   child->exited = false;
+  child->loaded = false;
   list_init(&child->child_process_list);
-  sema_init(child->wait_child, 0);
+  sema_init(&child->wait_child, 0);
 
   if (parent != NULL) 
   {
@@ -106,7 +165,7 @@ static void init_process(struct process *parent)
     child->parent_died = true;
   }
 
-  thread_current()->process = child;
+  return child;
 }
 
 /* A thread function that loads a user process and starts it
@@ -116,6 +175,8 @@ start_process (void *info)
 {
   struct process_info *process_info = (struct process_info *) info;
   char *command_line = process_info->process_args;
+  struct process *process = process_info->process;
+  struct semaphore *loaded = process_info->loaded;
 
   struct intr_frame if_;
 
@@ -125,12 +186,14 @@ start_process (void *info)
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
 
-  init_process(process_info->parent);
-  process_info->load_success = load (process_info->process_name, command_line, &if_.eip, &if_.esp);
-  sema_up(process_info->wait_load);
+  thread_current()->process = process;
+  process->loaded = load (process_info->process_name, command_line, &if_.eip, &if_.esp);
+  palloc_free_page (process_info);
+  if (loaded != NULL)
+    sema_up(loaded);
 
   /* If load failed, quit. */
-  if (!process_info->load_success) 
+  if (!process->loaded) 
     thread_exit ();
 
   /* Start the user process by simulating a return from an
@@ -160,8 +223,7 @@ static struct process *get_child_process(struct list *child_list, pid_t child_pi
 static void free_process(struct process *process)
 {
   list_remove(&process->child_process_elem);
-  free(process->wait_child);
-  free(process);
+  slab_free(&process_cache, process);
 }
 
 /* Waits for thread TID to die and returns its exit status. 
@@ -184,7 +246,7 @@ process_wait (tid_t child_tid)
     return -1;
   }
 
-  sema_down(child->wait_child);
+  sema_down(&child->wait_child);
   int status = child->exit_status;
   free_process(child);
   return status;
@@ -212,16 +274,6 @@ process_exit (void)
   uint32_t *pd;
   
   close_all();
-  
-  struct process *process = thread_current()->process;
-  notify_child_process(&process->child_process_list);
-  process->exited = true;
-  sema_up(process->wait_child);
-  if (process && process->parent_died)
-  {
-    free_process(process);
-  }
-
 
   /* Unmaps mappings when process exits */
 
@@ -249,12 +301,15 @@ process_exit (void)
   }
   lock_release(&filesys_lock);
 
+  destroy_thread_frames (cur);
   destroy_supp_pt (thread_current()->supp_page_table);
   thread_current()->supp_page_table = NULL;
 
 
   /* Destroy the current process's page directory and switch back
-     to the kernel-only page directory. */
+     to the kernel-only page directory.  With the reaper thread
+     running, the page directory and the pages it maps are freed
+     after the parent has been woken up. */
   pd = cur->pagedir;
   if (pd != NULL) 
   {
@@ -267,7 +322,18 @@ process_exit (void)
         that's been freed (and cleared). */
     cur->pagedir = NULL;
     pagedir_activate (NULL);
-    pagedir_destroy (pd);
+    pagedir_retire (pd);
+  }
+
+  /* Wake up the parent only once mapped files have been written
+     back, so that it sees their contents after wait(). */
+  struct process *process = cur->process;
+  notify_child_process(&process->child_process_list);
+  process->exited = true;
+  sema_up(&process->wait_child);
+  if (process && process->parent_died)
+  {
+    free_process(process);
   }
 }
 
@@ -279,8 +345,13 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  /* Activate thread's page tables.  Kernel threads only use
+     kernel mappings, which every page directory shares, so they
+     run in whichever address space is already loaded.  Reloading
+     the page directory that is already active would only flush
+     the TLB. */
+  if (t->pagedir != NULL && !pagedir_is_active (t->pagedir))
+    pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
@@ -351,6 +422,8 @@ struct Elf32_Phdr
 #define PF_R 4          /* Readable. */
 
 static bool setup_stack (void **esp);
+static bool parse_executable (struct file *, const char *file_name,
+                              struct exec_image *);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
@@ -364,11 +437,13 @@ bool
 load (const char *file_name, char *args, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  const struct exec_image *image;
+  struct exec_segment *segments = NULL;
+  size_t segment_cnt = 0;
+  void (*entry) (void) = NULL;
   struct file *file = NULL;
-  off_t file_ofs;
   bool success = false;
-  int i;
+  size_t i;
 
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
@@ -378,7 +453,9 @@ load (const char *file_name, char *args, void (**eip) (void), void **esp)
     goto done;
   process_activate ();
 
-  /* Open executable file. */
+  /* Open executable file.  Only the file system work is done
+     under filesys_lock, so that processes started by spawn can
+     set up their address spaces in parallel. */
   lock_acquire (&filesys_lock);
   file = filesys_open (file_name);
   if (file == NULL) 
@@ -391,6 +468,70 @@ load (const char *file_name, char *args, void (**eip) (void), void **esp)
   file_deny_write(file);
   thread_current()->executable = file;
 
+  /* Find the executable's segments, parsing it unless it is cached. */
+  image = exec_cache_lookup (file_get_inode (file));
+  if (image == NULL)
+    {
+      struct exec_image parsed;
+      if (!parse_executable (file, file_name, &parsed))
+        goto done;
+      image = exec_cache_insert (file_get_inode (file), &parsed);
+    }
+
+  /* The cached image may be evicted once filesys_lock is
+     released, so take a copy of what we need from it. */
+  entry = image->entry;
+  segment_cnt = image->segment_cnt;
+  segments = malloc (segment_cnt * sizeof *segments);
+  if (segments == NULL && segment_cnt > 0)
+    goto done;
+  memcpy (segments, image->segments, segment_cnt * sizeof *segments);
+  lock_release (&filesys_lock);
+
+  /* Record the segments for demand paging.  No file data is read
+     here: pages are read in when they are first touched. */
+  for (i = 0; i < segment_cnt; i++)
+    {
+      const struct exec_segment *seg = &segments[i];
+      if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+                         seg->read_bytes, seg->zero_bytes, seg->writable))
+        goto done;
+    }
+
+  /* Set up stack. */
+  if (!setup_stack (esp))
+    goto done;
+
+  /* Start address. */
+  *eip = entry;
+
+  /* Add arguments to stack. */
+  if (!push_arguments (esp, file_name, args))
+    goto done;
+
+  success = true;
+
+ done:
+  /* We arrive here whether the load is successful or not. */
+  if (lock_held_by_current_thread(&filesys_lock))
+    lock_release (&filesys_lock);
+  free (segments);
+  return success;
+}
+
+/* load() helpers. */
+
+/* Reads and validates the ELF header and program headers of
+   executable FILE, called FILE_NAME, into IMAGE.
+   Returns true if successful, false otherwise. */
+static bool
+parse_executable (struct file *file, const char *file_name,
+                  struct exec_image *image)
+{
+  struct Elf32_Ehdr ehdr;
+  off_t file_ofs;
+  int i;
+
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
@@ -402,20 +543,28 @@ load (const char *file_name, char *args, void (**eip) (void), void **esp)
       ) 
     {
       printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
+      return false;
     }
+
+  image->entry = (void (*) (void)) ehdr.e_entry;
+  image->segment_cnt = 0;
+  image->segments = malloc (ehdr.e_phnum * sizeof *image->segments);
+  if (image->segments == NULL && ehdr.e_phnum > 0)
+    return false;
+
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++) 
     {
       struct Elf32_Phdr phdr;
+      struct exec_segment *seg;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
+        goto error;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        goto error;
       file_ofs += sizeof phdr;
       switch (phdr.p_type) 
         {
@@ -429,62 +578,41 @@ load (const char *file_name, char *args, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          goto error;
         case PT_LOAD:
-          if (validate_segment (&phdr, file)) 
+          if (!validate_segment (&phdr, file)) 
+            goto error;
+
+          seg = &image->segments[image->segment_cnt++];
+          seg->writable = (phdr.p_flags & PF_W) != 0;
+          seg->file_page = phdr.p_offset & ~PGMASK;
+          seg->mem_page = phdr.p_vaddr & ~PGMASK;
+          uint32_t page_offset = phdr.p_vaddr & PGMASK;
+          if (phdr.p_filesz > 0)
+            {
+              /* Normal segment.
+                 Read initial part from disk and zero the rest. */
+              seg->read_bytes = page_offset + phdr.p_filesz;
+              seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+                                 - seg->read_bytes);
+            }
+          else 
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
-              uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
-              if (phdr.p_filesz > 0)
-                {
-                  /* Normal segment.
-                     Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
-                }
-              else 
-                {
-                  /* Entirely zero.
-                     Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
-                }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
+              /* Entirely zero.
+                 Don't read anything from disk. */
+              seg->read_bytes = 0;
+              seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
             }
-          else
-            goto done;
           break;
         }
     }
+  return true;
 
-  /* Set up stack. */
-  if (!setup_stack (esp))
-    goto done;
-
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
-
-  /* Add arguments to stack. */
-  if (!push_arguments (esp, file_name, args))
-    goto done;
-
-  success = true;
-
- done:
-  /* We arrive here whether the load is successful or not. */
-  if (lock_held_by_current_thread(&filesys_lock))
-    lock_release (&filesys_lock);
-  return success;
+ error:
+  free (image->segments);
+  return false;
 }
 
-/* load() helpers. */
-
 static bool install_page (void *upage, void *kpage, bool writable);
 
 
@@ -631,9 +759,24 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
   // printf("load segment\n");
+  struct thread *t = thread_current ();
   file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
+      /* A writable run of zero pages that covers a whole 4 MB
+         aligned region, such as a large array in the BSS aligned
+         to 4 MB, is mapped with one resident large page if
+         possible. */
+      if (writable && read_bytes == 0 && zero_bytes >= PTSPAN
+          && (uintptr_t) upage % PTSPAN == 0
+          && add_large_supp_pt (t->supp_page_table, t->pagedir, upage))
+        {
+          zero_bytes -= PTSPAN;
+          upage += PTSPAN;
+          ofs += PTSPAN;
+          continue;
+        }
+
       // printf("loop check\n");
       /* Calculate how to fill this page.
          We will read PAGE_READ_BYTES bytes from FILE
@@ -642,7 +785,6 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
       
       /* Check if virtual page already allocated */
-      struct thread *t = thread_current ();
       if(pagedir_get_page (t->pagedir, upage) != NULL)
       {
         // printf("null which is correct\n");
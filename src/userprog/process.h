@@ -13,7 +13,9 @@
 
 typedef uint32_t pid_t;
 
+void process_init (void);
 tid_t process_execute (const char *cmd_line);
+tid_t process_spawn (const char *cmd_line);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
@@ -24,7 +26,8 @@ struct process {
   bool exited;                          /* Indicates if process has exited */
   struct list child_process_list;       /* Contains the list of child process */
   struct list_elem child_process_elem;  /* list elem for assigning to parent process */
-  struct semaphore *wait_child;         /* Semaphore for waiting for this process to exit */
+  struct semaphore wait_child;          /* Semaphore for waiting for this process to exit */
+  bool loaded;                          /* Indicates if the executable was loaded */
   bool parent_died;                     /* Indicates if parent had exited */
 };
 
@@ -1,102 +1,328 @@
 #include "devices/input.h"
 #include "devices/shutdown.h"
 #include "filesys/file.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
 #include "lib/stdint.h"
 #include "lib/stdio.h"
 #include "process.h"
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
+#include "userprog/usercopy.h"
+#include <bitmap.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "lib/kernel/stdio.h"
 #include "vm/frame.h"
 
-#define NUM_OF_SYSCALLS 13
+#define NUM_OF_SYSCALLS (SYS_MEMSTAT + 1)
+#define SYSCALL_ARGS_MAX 4     /* Most arguments any system call takes. */
 
-static void syscall_handler (struct intr_frame *);
+#define FD_MIN 2               /* Lowest descriptor of an open file, below are the console. */
+#define FD_TABLE_SIZE 16       /* Initial size of a file descriptor table. */
 
 /* System calls. */
-static void halt (struct intr_frame *f);
-static void exit (struct intr_frame *f);
-static void exec (struct intr_frame *f);
-static void wait (struct intr_frame *f);
-static void create (struct intr_frame *f);
-static void remove (struct intr_frame *f);
-static void open (struct intr_frame *f);
-static void filesize (struct intr_frame *f);
-static void read (struct intr_frame *f);
-static void write (struct intr_frame *f);
-static void seek (struct intr_frame *f);
-static void tell (struct intr_frame *f);
-static void close (struct intr_frame *f);
-static void mmap (struct intr_frame *f);
-static void sys_munmap (struct intr_frame *f);
+static void halt (void) NO_RETURN;
+static void exit (int status) NO_RETURN;
+static pid_t exec (const char *cmd_line);
+static int wait (pid_t pid);
+static bool create (const char *ufile, unsigned initial_size);
+static bool remove (const char *ufile);
+static int open (const char *ufile);
+static int filesize (int fd);
+static int read (int fd, void *buffer, unsigned size);
+static int write (int fd, const void *buffer, unsigned size);
+static void seek (int fd, unsigned position);
+static unsigned tell (int fd);
+static void close (int fd);
+static mapid_t mmap (int fd, void *addr);
+static void sys_munmap (mapid_t mapping_id);
+static int readv (int fd, const struct iovec *iov, int iovcnt);
+static int writev (int fd, const struct iovec *iov, int iovcnt);
+static int pread (int fd, void *buffer, unsigned size, off_t offset);
+static int pwrite (int fd, const void *buffer, unsigned size, off_t offset);
+static int io_submit (struct io_ring *ring);
+static pid_t spawn (const char *cmd_line);
+static bool memstat (struct memstat *stat);
 
 /* Helper functions. */
-static struct fd *find_fd (struct thread *t, int fd_id);
+static struct file *find_fd (struct thread *t, int fd_id);
+static int alloc_fd (struct thread *t, struct file *file);
+static void free_fd (struct thread *t, int fd_id);
+static bool grow_fd_table (struct thread *t);
+static int open_fd (const char *file);
+static void close_fd (int fd);
+static int file_io (int fd, uint8_t *buffer, unsigned size, bool to_file);
+static int submit_entry (const struct io_sqe *sqe);
+static pid_t start_command (const char *cmd_line, tid_t (*start) (const char *));
 static struct md *find_md (struct thread *t, mapid_t mapping_id);
-static int get_user (const uint8_t *uaddr);
-static bool put_user (uint8_t *udst, uint8_t byte);
-static bool is_string_valid (char *str);
-static bool is_buffer_valid (void *addr, int size);
-static char *get_address (void *addr);
+static bool get_string (const char *ustr, char *dst, size_t size);
+static bool read_stdin (uint8_t *buffer, unsigned size);
+static int vectored_io (int fd, const struct iovec *uiov, int iovcnt, bool to_file);
+static int positional_io (int fd, uint8_t *buffer, unsigned size, off_t offset,
+                          bool to_file);
+static bool is_buffer_valid (const void *buffer, unsigned size, bool writable);
+static int transfer_buffer (struct file *file, uint8_t *buffer, unsigned size, bool to_file,
+                            off_t *pos);
 static uint32_t get_num (void *addr);
 
+/* Cache the memory mapping descriptors are allocated from. */
+static struct slab_cache md_cache;
 
-static void (*syscall_function[NUM_OF_SYSCALLS])(struct intr_frame *);
+/* System call number and arguments, as pushed on the user stack. */
+struct syscall_args
+{
+  uint32_t number;
+  uint32_t arg[SYSCALL_ARGS_MAX];
+};
+
+/* A system call handler.  Each one converts the raw arguments it
+   uses to the types the system call takes, calls it and returns
+   its result as the value for eax: 0 or 1 for a bool, 0 if the
+   system call returns nothing. */
+typedef uint32_t syscall_func (uint32_t, uint32_t, uint32_t, uint32_t);
+
+static syscall_func call_halt, call_exit, call_exec, call_wait, call_create,
+  call_remove, call_open, call_filesize, call_read, call_write, call_seek,
+  call_tell, call_close, call_mmap, call_munmap, call_readv, call_writev,
+  call_pread, call_pwrite, call_io_submit, call_spawn, call_memstat;
+
+/* Entry in the system call table. */
+struct syscall
+{
+  syscall_func *func;          /* Handler. */
+  size_t argc;                 /* Number of arguments it takes. */
+};
+
+#define SYSCALL(NAME, ARGC) { call_##NAME, (ARGC) }
+
+static const struct syscall syscalls[NUM_OF_SYSCALLS] =
+{
+  [SYS_HALT] = SYSCALL (halt, 0),
+  [SYS_EXIT] = SYSCALL (exit, 1),
+  [SYS_EXEC] = SYSCALL (exec, 1),
+  [SYS_WAIT] = SYSCALL (wait, 1),
+  [SYS_CREATE] = SYSCALL (create, 2),
+  [SYS_REMOVE] = SYSCALL (remove, 1),
+  [SYS_OPEN] = SYSCALL (open, 1),
+  [SYS_FILESIZE] = SYSCALL (filesize, 1),
+  [SYS_READ] = SYSCALL (read, 3),
+  [SYS_WRITE] = SYSCALL (write, 3),
+  [SYS_SEEK] = SYSCALL (seek, 2),
+  [SYS_TELL] = SYSCALL (tell, 1),
+  [SYS_CLOSE] = SYSCALL (close, 1),
+  [SYS_MMAP] = SYSCALL (mmap, 2),
+  [SYS_MUNMAP] = SYSCALL (munmap, 1),
+  [SYS_READV] = SYSCALL (readv, 3),
+  [SYS_WRITEV] = SYSCALL (writev, 3),
+  [SYS_PREAD] = SYSCALL (pread, 4),
+  [SYS_PWRITE] = SYSCALL (pwrite, 4),
+  [SYS_IO_SUBMIT] = SYSCALL (io_submit, 1),
+  [SYS_SPAWN] = SYSCALL (spawn, 1),
+  [SYS_MEMSTAT] = SYSCALL (memstat, 1),
+};
 
 
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  syscall_function[SYS_HALT] = &halt;
-  syscall_function[SYS_EXIT] = &exit;
-  syscall_function[SYS_EXEC] = &exec;
-  syscall_function[SYS_WAIT] = &wait;
-  syscall_function[SYS_CREATE] = &create;
-  syscall_function[SYS_REMOVE] = &remove;
-  syscall_function[SYS_OPEN] = &open;
-  syscall_function[SYS_FILESIZE] = &filesize;
-  syscall_function[SYS_READ] = &read;
-  syscall_function[SYS_WRITE] = &write;
-  syscall_function[SYS_SEEK] = &seek;
-  syscall_function[SYS_TELL] = &tell;
-  syscall_function[SYS_CLOSE] = &close;
-  syscall_function[SYS_MMAP] = &mmap;
-  syscall_function[SYS_MUNMAP] = &sys_munmap;
   lock_init (&filesys_lock);
+  slab_cache_init (&md_cache, "md", sizeof (struct md), NULL);
 }
 
-static void
+/* Carries out the system call whose number and arguments are on
+   the user stack at f->esp, for both the int $0x30 gate and the
+   SYSENTER entry in syscall-entry.S.
+
+   The number and the longest possible argument list are fetched
+   with a single copy, cut short at PHYS_BASE.  A page fault
+   partway through only shortens the copy, so the process is
+   terminated only if the arguments this system call takes could
+   not all be read. */
+void
 syscall_handler (struct intr_frame *f) 
 {
-  uint32_t syscall_no = *(uint32_t *) f->esp;
-  thread_current()->esp = (uint32_t) f->esp;
-  syscall_function[syscall_no](f);
+  struct syscall_args args;
+  size_t size = sizeof args;
+  uintptr_t esp = (uintptr_t) f->esp;
+
+  thread_current()->esp = esp;
+  if (esp >= (uintptr_t) PHYS_BASE)
+  {
+    exit_exception ();
+  }
+  if ((uintptr_t) PHYS_BASE - esp < size)
+  {
+    size = (uintptr_t) PHYS_BASE - esp;
+  }
+  size -= copy_from_user (&args, f->esp, size);
+
+  if (size < sizeof args.number || args.number >= NUM_OF_SYSCALLS
+      || syscalls[args.number].func == NULL)
+  {
+    exit_exception ();
+  }
+  const struct syscall *call = &syscalls[args.number];
+  if (size < sizeof args.number + call->argc * sizeof *args.arg)
+  {
+    exit_exception ();
+  }
+
+  f->eax = call->func (args.arg[0], args.arg[1], args.arg[2], args.arg[3]);
 }
 
-// Stores the return value in EAX on frame
-static void return_frame(struct intr_frame *f, int value)
+/* Handlers for the system call table. */
+
+static uint32_t call_halt (uint32_t a0 UNUSED, uint32_t a1 UNUSED,
+                           uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  halt ();
+}
+
+static uint32_t call_exit (uint32_t a0, uint32_t a1 UNUSED,
+                           uint32_t a2 UNUSED, uint32_t a3 UNUSED)
 {
-  f->eax = value;
+  exit ((int) a0);
+}
+
+static uint32_t call_exec (uint32_t a0, uint32_t a1 UNUSED,
+                           uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return exec ((const char *) a0);
+}
+
+static uint32_t call_wait (uint32_t a0, uint32_t a1 UNUSED,
+                           uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return wait ((pid_t) a0);
+}
+
+static uint32_t call_create (uint32_t a0, uint32_t a1,
+                             uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return create ((const char *) a0, (unsigned) a1) ? 1 : 0;
+}
+
+static uint32_t call_remove (uint32_t a0, uint32_t a1 UNUSED,
+                             uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return remove ((const char *) a0) ? 1 : 0;
+}
+
+static uint32_t call_open (uint32_t a0, uint32_t a1 UNUSED,
+                           uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return open ((const char *) a0);
+}
+
+static uint32_t call_filesize (uint32_t a0, uint32_t a1 UNUSED,
+                               uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return filesize ((int) a0);
+}
+
+static uint32_t call_read (uint32_t a0, uint32_t a1,
+                           uint32_t a2, uint32_t a3 UNUSED)
+{
+  return read ((int) a0, (void *) a1, (unsigned) a2);
+}
+
+static uint32_t call_write (uint32_t a0, uint32_t a1,
+                            uint32_t a2, uint32_t a3 UNUSED)
+{
+  return write ((int) a0, (const void *) a1, (unsigned) a2);
+}
+
+static uint32_t call_seek (uint32_t a0, uint32_t a1,
+                           uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  seek ((int) a0, (unsigned) a1);
+  return 0;
+}
+
+static uint32_t call_tell (uint32_t a0, uint32_t a1 UNUSED,
+                           uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return tell ((int) a0);
+}
+
+static uint32_t call_close (uint32_t a0, uint32_t a1 UNUSED,
+                            uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  close ((int) a0);
+  return 0;
+}
+
+static uint32_t call_mmap (uint32_t a0, uint32_t a1,
+                           uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return mmap ((int) a0, (void *) a1);
+}
+
+static uint32_t call_munmap (uint32_t a0, uint32_t a1 UNUSED,
+                             uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  sys_munmap ((mapid_t) a0);
+  return 0;
+}
+
+static uint32_t call_readv (uint32_t a0, uint32_t a1,
+                            uint32_t a2, uint32_t a3 UNUSED)
+{
+  return readv ((int) a0, (const struct iovec *) a1, (int) a2);
+}
+
+static uint32_t call_writev (uint32_t a0, uint32_t a1,
+                             uint32_t a2, uint32_t a3 UNUSED)
+{
+  return writev ((int) a0, (const struct iovec *) a1, (int) a2);
+}
+
+static uint32_t call_pread (uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+  return pread ((int) a0, (void *) a1, (unsigned) a2, (off_t) a3);
+}
+
+static uint32_t call_pwrite (uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+  return pwrite ((int) a0, (const void *) a1, (unsigned) a2, (off_t) a3);
+}
+
+static uint32_t call_io_submit (uint32_t a0, uint32_t a1 UNUSED,
+                                uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return io_submit ((struct io_ring *) a0);
+}
+
+static uint32_t call_spawn (uint32_t a0, uint32_t a1 UNUSED,
+                            uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return spawn ((const char *) a0);
+}
+
+static uint32_t call_memstat (uint32_t a0, uint32_t a1 UNUSED,
+                              uint32_t a2 UNUSED, uint32_t a3 UNUSED)
+{
+  return memstat ((struct memstat *) a0) ? 1 : 0;
 }
 
  // Terminates Pintos
-static void halt (struct intr_frame *f UNUSED) 
+static void halt (void) 
 {
   shutdown_power_off();
 }
 
 // Terminates the current user program
-static void exit (struct intr_frame *f) 
+static void exit (int status) 
 {
-  int status = get_num (f->esp + 4);
   close_all();
   struct thread *current = thread_current();
   current->process->exit_status = status;
@@ -115,289 +341,114 @@ void exit_exception (void)
 }
 
 // Run executable
-static void exec (struct intr_frame *f) 
+static pid_t exec (const char *cmd_line) 
 {
-  char *file = get_address (f->esp + 4);
-  tid_t thread_id = process_execute(file);
-  return_frame(f, thread_id);
+  return start_command (cmd_line, process_execute);
 }
 
 // Wait for child process
-static void wait (struct intr_frame *f) 
+static int wait (pid_t pid) 
 {
-  pid_t pid = get_num (f->esp + 4);
-  return_frame(f, process_wait(pid));
+  return process_wait(pid);
 }
 
 /* Creates a new file called file initially initial size bytes in size. 
    Returns true if successful, false otherwise. */
-static void create (struct intr_frame *f) 
+static bool create (const char *ufile, unsigned initial_size) 
 {
-  const char *file = get_address (f->esp + 4);
-  unsigned initial_size = get_num (f->esp + 8);
-  if (!is_string_valid((char *) file))
+  char file[NAME_MAX + 1];
+  if (!get_string (ufile, file, sizeof file))
   {
-    return_frame(f, false);
-    return;
+    return false;
   }
 
   bool success;
   lock_acquire (&filesys_lock);
   success = filesys_create(file, initial_size);
   lock_release (&filesys_lock);
-  return_frame(f, success);
+  return success;
 }
 
 /* Deletes the file called file. 
    Returns true if successful, false otherwise. */
-static void remove (struct intr_frame *f)
+static bool remove (const char *ufile)
 {
-  const char *file = get_address (f->esp + 4);
-  if (!is_string_valid((char *) file))
+  char file[NAME_MAX + 1];
+  if (!get_string (ufile, file, sizeof file))
   {
-    return_frame(f, false);
-    return;
+    return false;
   }
 
   bool success;
   lock_acquire (&filesys_lock);
   success = filesys_remove(file);
   lock_release (&filesys_lock);
-  return_frame(f, success);
+  return success;
 }
 
 /* Opens the file called file. 
    Returns a nonnegative integer handle called a "file descriptor" (fd),
    or -1 if the file could not be opened. */
-static void open (struct intr_frame *f)
+static int open (const char *ufile)
 {
-  const char *file = get_address (f->esp + 4);
-  if (!is_string_valid((char *) file))
-  {
-    return_frame(f, -1);
-    return;
-  }
-  
-  lock_acquire (&filesys_lock);
-  
-  /* Attempt to open file. */
-  struct file *open_file = filesys_open (file);
-  if (!open_file)
+  char file[NAME_MAX + 1];
+  if (!get_string (ufile, file, sizeof file))
   {
-    lock_release (&filesys_lock);
-    return_frame(f, -1);
-    return;
-  }
-
-  /* Allocate memory. */
-  struct fd *file_desc = malloc(sizeof(struct fd));
-  if (!file_desc)
-  {
-    lock_release (&filesys_lock);
-    return_frame(f, -1);
-    return;
-  }
-
-  /* Assign file info to file descriptor. */
-  file_desc->file = open_file;
-  file_desc->process = thread_current()->tid;
-
-  struct list* fd_list = &thread_current()->open_fd;
-  if (list_empty(fd_list)) 
-  {
-    file_desc->id = 2;
-  }
-  else 
-  {
-    file_desc->id = (list_entry(list_back(fd_list), struct fd, elem)->id) + 1;
+    return -1;
   }
-  list_push_back(fd_list, &(file_desc->elem));
-
-  lock_release (&filesys_lock);
-  return_frame(f, file_desc->id);
+  return open_fd (file);
 }
 
 /* Returns the size, in bytes, of the file open as fd. */
-static void filesize (struct intr_frame *f)
+static int filesize (int fd)
 {
-  int fd = get_num (f->esp + 4);
   int size = -1;
   lock_acquire (&filesys_lock);
-  struct fd *file_desc = find_fd (thread_current(), fd);
-  if (file_desc)
+  struct file *file = find_fd (thread_current(), fd);
+  if (file)
   {
-    size = file_length (file_desc->file);
+    size = file_length (file);
   }
   lock_release (&filesys_lock);
-  return_frame(f, size);
+  return size;
 }
 
 /* Reads size bytes from the file open as fd into buffer. 
    Returns the number of bytes actually read (0 at end of file), 
    or -1 if the file could not be read 
    (due to a condition other than end of file). */
-static void read (struct intr_frame *f)
+static int read (int fd, void *buffer, unsigned size)
 {
-  int fd = get_num (f->esp + 4);
-  const void *buffer = get_address (f->esp + 8);
-  unsigned size = get_num (f->esp + 12);
-  if (!is_buffer_valid((void *) buffer, size)) 
+  int num_bytes = file_io (fd, buffer, size, false);
+  if (num_bytes == -1)
   {
     exit_exception ();
-    return;
-  }
-
-  int num_bytes;
-
-  if (fd == STDOUT_FILENO)
-  {
-    exit_exception();
-    return;
-  }
-  
-
-  if (fd == STDIN_FILENO) 
-  {
-    /* Must fill buffer from STDIN. */
-    for (unsigned i = 0; i < size; i++) 
-    {
-      if (!put_user((void *) (buffer + i), input_getc())) 
-      {
-        return_frame(f, -1);
-        return;
-      }
-    }
-    num_bytes = size;
-  } 
-  else
-  {
-    lock_acquire (&filesys_lock);
-    num_bytes = -1;
-    struct fd *file_desc = find_fd (thread_current(), fd);
-    if (!file_desc) 
-    {
-      lock_release (&filesys_lock);
-      exit_exception ();
-      return;
-    }
-
-    if (f->esp - (void *) buffer > 32)
-    {
-      lock_release (&filesys_lock);
-      exit_exception ();
-      return;
-    }
-    
-    struct supp_page_table *spt = thread_current()->supp_page_table;
-    for(void *address = pg_round_down(buffer); 
-        address < buffer + size; 
-        address += PGSIZE)
-    {
-      struct page *page = find_page(spt, address);
-      if (!page) 
-      {
-        exit_exception();
-      }
-      load_page (page, thread_current()->pagedir, address);
-      set_used (page->faddress, true);
-    }
-    
-    num_bytes = file_read (file_desc->file, (void *) buffer, size);
-
-    for (void *address = pg_round_down(buffer);
-        address < buffer + size; 
-        address += PGSIZE)
-    {
-      struct page *page = find_page (spt, address);
-      if (page->page_from == FRAME)
-      {
-        set_used (page->faddress, false);
-      }
-    }
-
-    lock_release (&filesys_lock);
   }
-
-  return_frame(f, num_bytes);
+  return num_bytes;
 }
 
 /* Writes size bytes from buffer to the open file fd. 
    Returns the number of bytes actually written, which may 
    be less than size if some bytes could not be written. */
-static void write (struct intr_frame *f)
+static int write (int fd, const void *buffer, unsigned size)
 {
-  int fd = get_num (f->esp + 4);
-  const void *buffer = get_address (f->esp + 8);
-  unsigned size = get_num (f->esp + 12);
-  if (!is_buffer_valid((void *) buffer, size)) 
-  {
-    exit_exception ();
-    return;
-  }
-
-  if (fd == STDIN_FILENO)
-  {
-    exit_exception();
-    return;
-  }
-
-  /* Write to console. */
-  if (fd == STDOUT_FILENO) 
+  int bytes_written = file_io (fd, (uint8_t *) buffer, size, true);
+  if (bytes_written == -1)
   {
-    putbuf(buffer, size);
-    return_frame(f, size);
-    return;
-  }
-
-  /* Write to file. */
-  lock_acquire(&filesys_lock);
-  struct fd *file_desc = find_fd(thread_current(), fd);
-
-  if (!file_desc) 
-  {
-    lock_release(&filesys_lock);
     exit_exception ();
-    return;
-  }
-
-  struct supp_page_table *spt = thread_current()->supp_page_table;
-  for (void *address = pg_round_down(buffer); 
-      address < buffer + size; 
-      address += PGSIZE)
-  {
-    struct page *page = find_page(spt, address);
-    load_page (page, thread_current()->pagedir, address);
-    set_used (page->faddress, true);
   }
-
-  int bytes_written = file_write(file_desc->file, buffer, size);
-
-  for (void *address = pg_round_down(buffer);
-      address < buffer + size; 
-      address += PGSIZE)
-  {
-    struct page *page = find_page (spt, address);
-    if (page->page_from == FRAME)
-    {
-      set_used (page->faddress, false);
-    }
-  }
-
-  lock_release(&filesys_lock);
-  return_frame(f, bytes_written);
+  return bytes_written;
 }
 
 /* Changes the next byte to be read or written in open file fd 
    to position, expressed in bytes from the beginning of the file. */
-static void seek (struct intr_frame *f)
+static void seek (int fd, unsigned position)
 {
-  int fd = get_num (f->esp + 4);
-  unsigned position = get_num (f->esp + 8);
   lock_acquire (&filesys_lock);
-  struct fd *file_desc = find_fd (thread_current(), fd);
-  if (file_desc)
+  struct file *file = find_fd (thread_current(), fd);
+  if (file)
   {
-    file_seek (file_desc->file, position);
+    file_seek (file, position);
   }
 
   lock_release (&filesys_lock);
@@ -405,83 +456,62 @@ static void seek (struct intr_frame *f)
 
 /* Returns the position of the next byte to be read or written 
    in open file fd, expressed in bytes from the beginning of the file. */
-static void tell (struct intr_frame *f)
+static unsigned tell (int fd)
 {
-  int fd = get_num (f->esp + 4);
   lock_acquire (&filesys_lock);
-  struct fd *file_desc = find_fd (thread_current(), fd);
+  struct file *file = find_fd (thread_current(), fd);
   unsigned position = -1;
 
-  if (file_desc)
+  if (file)
   {
-    position = file_tell (file_desc->file);
+    position = file_tell (file);
   }
 
   lock_release (&filesys_lock);
-  return_frame(f, position);
+  return position;
 }
 
 /* Closes file descriptor fd. 
    Exiting or terminating a process implicitly closes all its open file
    descriptors, as if by calling this function for each one. */
-static void close (struct intr_frame *f)
+static void close (int fd)
 {
-  int fd = get_num (f->esp + 4);
-  lock_acquire (&filesys_lock);
-
-  struct fd *file_desc = find_fd (thread_current(), fd);
-
-  if (file_desc && thread_current()->tid == (tid_t) file_desc->process)
-  {
-    list_remove (&file_desc->elem);
-    file_close (file_desc->file);
-    free (file_desc);
-  }
-
-  lock_release (&filesys_lock);
+  close_fd (fd);
 }
 
 /* System Calls for memory mapping*/
 
 /* Maps file open as fd into process' virtual address space */
-static void mmap (struct intr_frame *f)
+static mapid_t mmap (int fd, void *addr)
 {
-  int fd = get_num (f->esp + 4);
-
   if (fd < 2)
   {
-    return_frame (f, -1);
-    return;
+    return -1;
   }
 
-  void *addr = get_address (f->esp + 8);
-
   if (addr == NULL)
   {
-    return_frame (f, -1);
-    return;
+    return -1;
   }
 
   lock_acquire (&filesys_lock);
-  struct fd *file_desc = find_fd (thread_current(), fd);
+  struct file *file = find_fd (thread_current(), fd);
   struct file *reopened_file = NULL;
-  if (file_desc && file_desc->file) 
+  if (file) 
   {
     // Reopens the file so that it doesn't interfere with process to be stored in mmap_desc
-    reopened_file = file_reopen (file_desc->file);
+    reopened_file = file_reopen (file);
     
   }
   if (!reopened_file)
   {
     lock_release (&filesys_lock);
-    return_frame (f, -1);
-    return;
+    return -1;
   }
 
   if ((int) addr % PGSIZE != 0) {
     lock_release (&filesys_lock);
-    return_frame (f, -1);
-    return;
+    return -1;
   }
 
   /* Call to mmap may fail if file has length of zero bytes */
@@ -489,8 +519,7 @@ static void mmap (struct intr_frame *f)
   if (size == 0)
   {
     lock_release (&filesys_lock);
-    return_frame (f, -1);
-    return;
+    return -1;
   }
 
   /* Check if the range of pages overlaps any existing set of mapped pages */
@@ -502,8 +531,7 @@ static void mmap (struct intr_frame *f)
     if (find_page (thread_current()->supp_page_table, map_addr))
     {
       lock_release (&filesys_lock);
-      return_frame (f, -1);
-      return;
+      return -1;
     }
 
   }
@@ -529,7 +557,7 @@ static void mmap (struct intr_frame *f)
     mapping_id = 1;
   }
 
-  struct md *mmap_desc = (struct md*) malloc(sizeof(struct md));
+  struct md *mmap_desc = slab_alloc (&md_cache);
   mmap_desc->id = mapping_id;
   mmap_desc->file = reopened_file;
   mmap_desc->addr = addr;
@@ -537,12 +565,11 @@ static void mmap (struct intr_frame *f)
   list_push_back (&thread_current()->mmap_list, &mmap_desc->elem);
 
   lock_release (&filesys_lock);
-  return_frame (f, mapping_id);
+  return mapping_id;
 }
 
-static void sys_munmap (struct intr_frame *f)
+static void sys_munmap (mapid_t mapping_id)
 {
-  mapid_t mapping_id = get_num (f->esp + 4);
   munmap (mapping_id);
 }
 
@@ -557,22 +584,126 @@ bool munmap (mapid_t mapping_id)
 
   lock_acquire (&filesys_lock);
 
-  int32_t size = (int32_t) mmap_desc->size;
-  for (int32_t offset = 0; offset < size; offset += PGSIZE)
-  {
-    void *map_addr = mmap_desc->addr + offset;
-    uint32_t bytes = offset + PGSIZE < size ? PGSIZE : size - offset;
-
-    unmap_supp_pt (thread_current()->supp_page_table, thread_current()->pagedir, map_addr, mmap_desc->file, offset, bytes);
-  }
+  unmap_supp_pt (thread_current()->supp_page_table, thread_current()->pagedir,
+                 mmap_desc->addr, mmap_desc->file, mmap_desc->size);
 
   list_remove (&mmap_desc->elem);
   file_close (mmap_desc->file);
-  free (mmap_desc);
+  slab_free (&md_cache, mmap_desc);
   lock_release (&filesys_lock);
   return true;
 }
 
+/* Extended I/O system calls */
+
+/* Reads from the file open as fd into the iovcnt buffers described by iov,
+   filling each buffer before moving on to the next.
+   Returns the number of bytes read, or -1 if iovcnt is out of range or the
+   buffers add up to more than INT_MAX bytes. */
+static int readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return vectored_io (fd, iov, iovcnt, false);
+}
+
+/* Writes the iovcnt buffers described by iov to the file open as fd, in order.
+   Returns the number of bytes written, or -1 if iovcnt is out of range or
+   the buffers add up to more than INT_MAX bytes. */
+static int writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return vectored_io (fd, iov, iovcnt, true);
+}
+
+/* Reads size bytes from the file open as fd into buffer, starting at byte
+   offset of the file.  The file's position is left unchanged.
+   Returns the number of bytes read, or -1 if fd is the console
+   or offset is negative. */
+static int pread (int fd, void *buffer, unsigned size, off_t offset)
+{
+  return positional_io (fd, buffer, size, offset, false);
+}
+
+/* Writes size bytes from buffer to the file open as fd, starting at byte
+   offset of the file.  The file's position is left unchanged.
+   Returns the number of bytes written, or -1 if fd is the console
+   or offset is negative. */
+static int pwrite (int fd, const void *buffer, unsigned size, off_t offset)
+{
+  return positional_io (fd, (uint8_t *) buffer, size, offset, true);
+}
+
+/* Submits the operations queued in the submission queue of ring, in order,
+   and posts a completion for each of them to its completion queue.
+   Stops early when the completion queue is full.
+   Returns the number of operations consumed, or -1 if the ring's
+   indices are inconsistent. */
+static int io_submit (struct io_ring *ring)
+{
+  unsigned sq_head = get_num (&ring->sq_head);
+  unsigned sq_tail = get_num (&ring->sq_tail);
+  unsigned cq_head = get_num (&ring->cq_head);
+  unsigned cq_tail = get_num (&ring->cq_tail);
+  if (sq_tail - sq_head > IO_RING_SIZE || cq_tail - cq_head > IO_RING_SIZE)
+  {
+    return -1;
+  }
+
+  int consumed = 0;
+  while (sq_head != sq_tail && cq_tail - cq_head < IO_RING_SIZE)
+  {
+    struct io_sqe sqe;
+    if (copy_from_user (&sqe, &ring->sq[sq_head % IO_RING_SIZE], sizeof sqe) != 0)
+    {
+      exit_exception ();
+    }
+
+    struct io_cqe cqe;
+    cqe.user_data = sqe.user_data;
+    cqe.result = submit_entry (&sqe);
+    if (copy_to_user (&ring->cq[cq_tail % IO_RING_SIZE], &cqe, sizeof cqe) != 0)
+    {
+      exit_exception ();
+    }
+    sq_head++;
+    cq_tail++;
+    consumed++;
+  }
+
+  /* Publish the new indices only once all completions are in place. */
+  if (copy_to_user (&ring->sq_head, &sq_head, sizeof sq_head) != 0
+      || copy_to_user (&ring->cq_tail, &cq_tail, sizeof cq_tail) != 0)
+  {
+    exit_exception ();
+  }
+  return consumed;
+}
+
+/* Extended process control system calls */
+
+/* Runs the executable given in cmd_line like exec, but returns as soon
+   as the new process exists, without waiting for it to be loaded.
+   Returns the new process's pid, or -1 if it could not be created.
+   If the executable cannot be loaded, waiting for the pid returns -1. */
+static pid_t spawn (const char *cmd_line)
+{
+  return start_command (cmd_line, process_spawn);
+}
+
+/* Diagnostic system calls */
+
+/* Copies the memory usage statistics of the current process into stat.
+   Returns true if successful. */
+static bool memstat (struct memstat *stat)
+{
+  struct memstat kstat;
+  frame_get_memstat (thread_current (), &kstat);
+
+  if (copy_to_user (stat, &kstat, sizeof kstat) != 0)
+  {
+    exit_exception ();
+  }
+  return true;
+}
+
 /* Helper Functions */
 
 /* Function to close all files open by current thread. */
@@ -582,44 +713,227 @@ void close_all(void)
   {
 		lock_acquire (&filesys_lock);
   }
-  struct list_elem *e;
   struct thread *t = thread_current();
-  while (!list_empty (&t->open_fd))
-	{
-    e = list_begin(&t->open_fd);
-		int fd = list_entry (e, struct fd, elem)->id;
-		struct fd *file_desc = find_fd (t, fd);
-		if (file_desc)
+  for (size_t fd = FD_MIN; fd < t->fd_cnt; fd++)
+  {
+    if (t->fd_table[fd])
     {
-      list_remove (&file_desc->elem);
-      file_close (file_desc->file);
-      free (file_desc);
+      file_close (t->fd_table[fd]);
     }
-	}
+  }
+  free (t->fd_table);
+  bitmap_destroy (t->fd_map);
+  t->fd_table = NULL;
+  t->fd_map = NULL;
+  t->fd_cnt = 0;
 	lock_release (&filesys_lock);
 }
 
-/* Find the file descriptor in thread t using the 
+/* Find the open file in thread t using the 
    given file descriptor id. */
-static struct fd *find_fd (struct thread *t, int fd_id)
+static struct file *find_fd (struct thread *t, int fd_id)
 {
   ASSERT (t);
 
-  if (fd_id < 2) 
+  if (fd_id < FD_MIN || (size_t) fd_id >= t->fd_cnt) 
   {
     return NULL;
   }
+  return t->fd_table[fd_id];
+}
 
-	for (struct list_elem *e = list_begin (&t->open_fd); 
-       e != list_end (&t->open_fd);
-	     e = list_next (e))
-	{
-		struct fd *file_desc = list_entry (e, struct fd, elem);
-		if (file_desc->id == fd_id)
-			return file_desc;
-	}
+/* Add FILE to the file descriptor table of thread t, using the
+   lowest free descriptor.  Returns the descriptor, or -1 if the
+   table could not be grown. */
+static int alloc_fd (struct thread *t, struct file *file)
+{
+  size_t fd = BITMAP_ERROR;
+  if (t->fd_map)
+  {
+    fd = bitmap_scan_and_flip (t->fd_map, 0, 1, false);
+  }
+  if (fd == BITMAP_ERROR)
+  {
+    if (!grow_fd_table (t))
+    {
+      return -1;
+    }
+    fd = bitmap_scan_and_flip (t->fd_map, 0, 1, false);
+  }
 
-	return NULL;
+  t->fd_table[fd] = file;
+  return fd;
+}
+
+/* Remove descriptor fd_id from the file descriptor table of thread t. */
+static void free_fd (struct thread *t, int fd_id)
+{
+  t->fd_table[fd_id] = NULL;
+  bitmap_reset (t->fd_map, fd_id);
+}
+
+/* Double the capacity of the file descriptor table of thread t.
+   Returns false if out of memory. */
+static bool grow_fd_table (struct thread *t)
+{
+  size_t cnt = t->fd_cnt ? t->fd_cnt * 2 : FD_TABLE_SIZE;
+  struct file **table = realloc (t->fd_table, cnt * sizeof *table);
+  if (!table)
+  {
+    return false;
+  }
+  t->fd_table = table;
+
+  struct bitmap *map = bitmap_create (cnt);
+  if (!map)
+  {
+    return false;
+  }
+
+  /* Descriptors below FD_MIN belong to the console. */
+  bitmap_set_multiple (map, 0, FD_MIN, true);
+  for (size_t fd = FD_MIN; fd < cnt; fd++)
+  {
+    if (fd < t->fd_cnt)
+    {
+      bitmap_set (map, fd, bitmap_test (t->fd_map, fd));
+    }
+    else
+    {
+      table[fd] = NULL;
+    }
+  }
+
+  bitmap_destroy (t->fd_map);
+  t->fd_map = map;
+  t->fd_cnt = cnt;
+  return true;
+}
+
+/* Open the file called FILE, a kernel string, and give it the lowest
+   free file descriptor of the current thread.
+   Returns the descriptor, or -1 if the file could not be opened. */
+static int open_fd (const char *file)
+{
+  lock_acquire (&filesys_lock);
+  struct file *open_file = filesys_open (file);
+  if (!open_file)
+  {
+    lock_release (&filesys_lock);
+    return -1;
+  }
+
+  int fd = alloc_fd (thread_current(), open_file);
+  if (fd == -1)
+  {
+    file_close (open_file);
+  }
+  lock_release (&filesys_lock);
+  return fd;
+}
+
+/* Close file descriptor fd of the current thread, if it is open. */
+static void close_fd (int fd)
+{
+  lock_acquire (&filesys_lock);
+  struct file *file = find_fd (thread_current(), fd);
+  if (file)
+  {
+    free_fd (thread_current(), fd);
+    file_close (file);
+  }
+  lock_release (&filesys_lock);
+}
+
+/* Read SIZE bytes from fd into user address BUFFER, or write them to
+   fd if TO_FILE.  Returns the number of bytes transferred, or -1 if fd
+   is not open for that direction.
+   Terminates the process if BUFFER is not a valid pointer. */
+static int file_io (int fd, uint8_t *buffer, unsigned size, bool to_file)
+{
+  if (!is_buffer_valid (buffer, size, !to_file))
+  {
+    exit_exception ();
+  }
+
+  if (fd == (to_file ? STDIN_FILENO : STDOUT_FILENO))
+  {
+    return -1;
+  }
+
+  /* Console. */
+  if (fd == STDOUT_FILENO)
+  {
+    putbuf ((char *) buffer, size);
+    return size;
+  }
+  if (fd == STDIN_FILENO)
+  {
+    if (!read_stdin (buffer, size))
+    {
+      exit_exception ();
+    }
+    return size;
+  }
+
+  lock_acquire (&filesys_lock);
+  struct file *file = find_fd (thread_current(), fd);
+  int bytes = -1;
+  if (file)
+  {
+    bytes = transfer_buffer (file, buffer, size, to_file, NULL);
+  }
+  lock_release (&filesys_lock);
+  return bytes;
+}
+
+/* Carry out the ring operation SQE and return its result, which is
+   what the equivalent system call would have returned, or -1 where that
+   system call would have terminated the process for a bad descriptor.
+   A bad pointer still terminates the process. */
+static int submit_entry (const struct io_sqe *sqe)
+{
+  switch (sqe->op)
+  {
+    case IO_READ:
+      return file_io (sqe->fd, sqe->buf, sqe->len, false);
+    case IO_WRITE:
+      return file_io (sqe->fd, sqe->buf, sqe->len, true);
+    case IO_OPEN:
+    {
+      char file[NAME_MAX + 1];
+      if (!get_string (sqe->buf, file, sizeof file))
+      {
+        return -1;
+      }
+      return open_fd (file);
+    }
+    case IO_CLOSE:
+      close_fd (sqe->fd);
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+/* Copy the command line at user address CMD_LINE into the kernel
+   and pass it to START, which is process_execute() or process_spawn().
+   Returns the new process's pid, or TID_ERROR. */
+static pid_t start_command (const char *cmd_line, tid_t (*start) (const char *))
+{
+  char *kcmd_line = palloc_get_page (0);
+  if (!kcmd_line)
+  {
+    return TID_ERROR;
+  }
+
+  tid_t thread_id = TID_ERROR;
+  if (get_string (cmd_line, kcmd_line, PGSIZE))
+  {
+    thread_id = start (kcmd_line);
+  }
+  palloc_free_page (kcmd_line);
+  return thread_id;
 }
 
 /* Find the map descriptor in thread t using the 
@@ -638,99 +952,248 @@ static struct md *find_md (struct thread *t, mapid_t mapping_id)
 	return NULL;
 }
 
-/* Verify user pointer, then dereference it. */
-static void verify_pointer (void *addr)
+/* Read the 32-bit number at user address ADDR.
+   Terminates the process if ADDR is not a valid pointer. */
+static uint32_t get_num (void *addr)
 {
-  if (get_user ((uint8_t *) addr) == -1) 
+  uint32_t num;
+  if (copy_from_user (&num, addr, sizeof num) != 0)
   {
     exit_exception ();
   }
+  return num;
 }
 
-static char *get_address (void *addr)
+/* Copy the string at user address USTR into DST, which has room for
+   SIZE bytes.  Returns false if the string does not fit.
+   Terminates the process if USTR is not a valid pointer. */
+static bool get_string (const char *ustr, char *dst, size_t size)
 {
-  verify_pointer (addr);
-  return *((char **) addr);
+  int length = strncpy_from_user (dst, ustr, size);
+  if (length < 0)
+  {
+    exit_exception ();
+  }
+  return (size_t) length < size;
 }
 
-static uint32_t get_num (void *addr)
+/* Fill the SIZE bytes at user address BUFFER from the keyboard.
+   Returns false if BUFFER is not a valid pointer. */
+static bool read_stdin (uint8_t *buffer, unsigned size)
 {
-  verify_pointer (addr);
-  return *((uint32_t *) addr);
+  uint8_t kbuf[64];
+  for (unsigned i = 0; i < size; i += sizeof kbuf) 
+  {
+    unsigned chunk = size - i < sizeof kbuf ? size - i : sizeof kbuf;
+    for (unsigned j = 0; j < chunk; j++)
+    {
+      kbuf[j] = input_getc ();
+    }
+    if (copy_to_user (buffer + i, kbuf, chunk) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
 }
 
-/* Memory Access Helpers */
-
-/* Reads a byte at user virtual address UADDR.
-UADDR must be below PHYS_BASE.
-Returns the byte value if successful, -1 if a segfault
-occurred. */
-static int32_t
-get_user (const uint8_t *uaddr)
+/* Carry out readv, or writev if TO_FILE.  The iovec array is copied in
+   and every buffer is validated before any I/O is done, and the whole
+   request runs under a single acquisition of filesys_lock.  The byte
+   count must fit in the return value, so the request is rejected if the
+   buffers add up to more than INT_MAX bytes. */
+static int vectored_io (int fd, const struct iovec *uiov, int iovcnt, bool to_file)
 {
-  /* Check user address is below PHYS_BASE. */
-  if (!is_user_vaddr (uaddr))
+  struct iovec iov[IOV_MAX];
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
   {
     return -1;
   }
+  if (copy_from_user (iov, uiov, iovcnt * sizeof *iov) != 0)
+  {
+    exit_exception ();
+  }
+  unsigned length = 0;
+  for (int i = 0; i < iovcnt; i++)
+  {
+    if (iov[i].iov_len > INT_MAX - length)
+    {
+      return -1;
+    }
+    length += iov[i].iov_len;
+  }
+  for (int i = 0; i < iovcnt; i++)
+  {
+    if (!is_buffer_valid (iov[i].iov_base, iov[i].iov_len, !to_file))
+    {
+      exit_exception ();
+    }
+  }
+
+  if (fd == (to_file ? STDIN_FILENO : STDOUT_FILENO))
+  {
+    exit_exception ();
+  }
+
+  int total = 0;
+  if (fd == STDOUT_FILENO || fd == STDIN_FILENO)
+  {
+    for (int i = 0; i < iovcnt; i++)
+    {
+      if (to_file)
+      {
+        putbuf (iov[i].iov_base, iov[i].iov_len);
+      }
+      else if (!read_stdin (iov[i].iov_base, iov[i].iov_len))
+      {
+        exit_exception ();
+      }
+      total += iov[i].iov_len;
+    }
+    return total;
+  }
 
-  int result;
-  asm ("movl $1f, %0; movzbl %1, %0; 1:" : "=&a" (result) : "m" (*uaddr));
-  return result;
+  lock_acquire (&filesys_lock);
+  struct file *file = find_fd (thread_current(), fd);
+  if (!file)
+  {
+    lock_release (&filesys_lock);
+    exit_exception ();
+  }
+
+  for (int i = 0; i < iovcnt; i++)
+  {
+    unsigned bytes = transfer_buffer (file, iov[i].iov_base, iov[i].iov_len, to_file, NULL);
+    total += bytes;
+    if (bytes != iov[i].iov_len)
+    {
+      break;
+    }
+  }
+  lock_release (&filesys_lock);
+  return total;
 }
 
-/* Writes BYTE to user address UDST.
-UDST must be below PHYS_BASE.
-Returns true if successful, false if a segfault occurred. */
-static bool
-put_user (uint8_t *udst, uint8_t byte)
+/* Carry out pread, or pwrite if TO_FILE. */
+static int positional_io (int fd, uint8_t *buffer, unsigned size, off_t offset,
+                          bool to_file)
 {
-  /* Check user address is below PHYS_BASE. */
-  if (!is_user_vaddr (udst))
+  if (!is_buffer_valid (buffer, size, !to_file))
   {
-    return false;
+    exit_exception ();
+  }
+
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO || offset < 0)
+  {
+    return -1;
+  }
+
+  lock_acquire (&filesys_lock);
+  struct file *file = find_fd (thread_current(), fd);
+  if (!file)
+  {
+    lock_release (&filesys_lock);
+    exit_exception ();
   }
 
-  int error_code;
-  asm ("movl $1f, %0; movb %b2, %1; 1:" : "=&a" (error_code), "=m" (*udst) : "q" (byte));
-  return error_code != -1;
+  int bytes = transfer_buffer (file, buffer, size, to_file, &offset);
+  lock_release (&filesys_lock);
+  return bytes;
 }
 
-/* Check that a string is valid. */
-static bool is_string_valid (char *str)
+/* Check that the SIZE bytes at user address BUFFER are mapped,
+   looking up each page once.  Pages that are not in the supplemental
+   page table yet are probed, so that the page fault handler can grow
+   the stack into them.  If WRITABLE, the pages must also be writable. */
+static bool is_buffer_valid (const void *buffer, unsigned size, bool writable)
 {
-  int character = get_user ((uint8_t *) str);
+  if (size == 0)
+  {
+    return true;
+  }
 
-  if (character == -1)
+  const uint8_t *start = buffer;
+  const uint8_t *end = start + size - 1;
+  if (end < start || !is_user_vaddr (end))
   {
     return false;
   }
-  int i = 1;
-  while (character != '\0')
+
+  struct supp_page_table *spt = thread_current()->supp_page_table;
+  for (const uint8_t *upage = pg_round_down (start); upage <= end; upage += PGSIZE)
   {
-    character = get_user ((uint8_t *) (str + i));
-    if (character == -1)
+    struct page *page = find_page (spt, (void *) upage);
+    if (!page)
+    {
+      uint8_t probe;
+      if (copy_from_user (&probe, upage < start ? start : upage, 1) != 0)
+      {
+        return false;
+      }
+      page = find_page (spt, (void *) upage);
+      if (!page)
+      {
+        return false;
+      }
+    }
+    if (writable && page->file_info && !page->file_info->file_writeable)
     {
       return false;
     }
-    i++;
   }
 
   return true;
 }
 
-/* Check that a buffer of given size is valid. */
-static bool is_buffer_valid (void *addr, int size)
+/* Reads the SIZE bytes at user address BUFFER from FILE, or writes them
+   to FILE if TO_FILE, one page at a time.  Only the page being transferred
+   is pinned, so buffers larger than the user pool can still be paged.
+   The transfer starts at *POS, which is advanced, or at the file's
+   position if POS is a null pointer.
+   BUFFER must have been checked with is_buffer_valid ().
+   Returns the number of bytes transferred. */
+static int transfer_buffer (struct file *file, uint8_t *buffer, unsigned size, bool to_file,
+                            off_t *pos)
 {
-  char *buffer = (char *) addr;
-  for (int i = 0; i < size; i++)
+  struct thread *t = thread_current ();
+  unsigned done = 0;
+
+  while (done < size)
   {
-    if (get_user ((uint8_t *) (buffer + i)) == -1)
+    uint8_t *chunk = buffer + done;
+    unsigned chunk_size = PGSIZE - pg_ofs (chunk);
+    if (chunk_size > size - done)
     {
-      return false;
+      chunk_size = size - done;
+    }
+
+    struct page *page = find_page (t->supp_page_table, pg_round_down (chunk));
+    if (!page || !pin_page (page, t->pagedir))
+    {
+      break;
+    }
+    off_t bytes;
+    if (pos)
+    {
+      bytes = to_file ? file_write_at (file, chunk, chunk_size, *pos)
+                      : file_read_at (file, chunk, chunk_size, *pos);
+      *pos += bytes;
+    }
+    else
+    {
+      bytes = to_file ? file_write (file, chunk, chunk_size)
+                      : file_read (file, chunk, chunk_size);
+    }
+    unpin_page (page);
+
+    done += bytes;
+    if ((unsigned) bytes != chunk_size)
+    {
+      break;
     }
   }
 
-  return true;
+  return done;
 }
 
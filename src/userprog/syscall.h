@@ -8,8 +8,11 @@
 typedef uint32_t pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+struct intr_frame;
+
 void syscall_init (void);
-void exit_exception (void);
+void syscall_handler (struct intr_frame *);
+void exit_exception (void) NO_RETURN;
 void close_all (void);
 bool munmap (mapid_t mapping_id);
 
@@ -17,13 +20,4 @@ bool munmap (mapid_t mapping_id);
 /* Lock to be used when accessing the file system. */
 struct lock filesys_lock;
 
-/* Struct for file descriptors. */
-struct fd
-{
-    int id;
-    pid_t process;
-    struct file *file;
-    struct list_elem elem;
-};
-
 #endif /* userprog/syscall.h */
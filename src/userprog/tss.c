@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "threads/init.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -75,6 +76,15 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* Model-specific registers that configure SYSENTER.
+   See [IA32-v3a] 5.8.7 "Performing Fast Calls to System
+   Procedures with the SYSENTER and SYSEXIT Instructions". */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+static void sysenter_init (void);
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -86,6 +96,37 @@ tss_init (void)
   tss->ss0 = SEL_KDSEG;
   tss->bitmap = 0xdfff;
   tss_update ();
+  sysenter_init ();
+}
+
+/* Writes VALUE to model-specific register MSR. */
+static void
+wrmsr (uint32_t msr, uint32_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+/* Sets up SYSENTER to enter the kernel at syscall_sysenter, if
+   the CPU has it.  User programs make the same CPUID check to
+   decide whether they may use it.
+
+   SYSENTER does not switch to the stack in the TSS the way an
+   interrupt from user mode does.  Instead it loads the stack
+   pointer from MSR_SYSENTER_ESP, which holds a single value, so
+   we point it at the TSS's esp0 member and let the entry stub
+   load the thread's stack from there.  That way tss_update()
+   keeps working for both ways into the kernel. */
+static void
+sysenter_init (void)
+{
+  extern char syscall_sysenter[];
+
+  if (!(cpu_features () & CPUID_SEP))
+    return;
+
+  wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+  wrmsr (MSR_SYSENTER_ESP, (uint32_t) &tss->esp0);
+  wrmsr (MSR_SYSENTER_EIP, (uint32_t) syscall_sysenter);
 }
 
 /* Returns the kernel TSS. */
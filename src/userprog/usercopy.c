@@ -0,0 +1,130 @@
+#include "userprog/usercopy.h"
+#include <stdint.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Copying to and from user memory.
+
+   The kernel may not trust a pointer passed in by a user
+   process: it may be null, point into kernel memory, or point to
+   user memory that is not mapped.  Rather than checking every
+   byte before touching it, the routines here reject pointers
+   outside user memory up front and then copy with REP MOVS
+   string instructions.  Unmapped pages that belong to the
+   process are brought in by the page fault handler as usual.  If
+   a page cannot be brought in, the page fault handler calls
+   usercopy_fixup(), which ends the copy early, and the caller
+   sees how many bytes were not copied. */
+
+/* Labels inside user_copy(): the two string instructions that
+   may fault, and the point where a faulted copy resumes. */
+extern const char user_copy_dwords[], user_copy_bytes[], user_copy_done[];
+
+static bool is_user_range (const void *, size_t);
+
+/* Copies SIZE bytes from SRC to DST, one of which is in user
+   memory.  Returns the number of bytes not copied, which is
+   nonzero only if a page fault could not be resolved.
+
+   The labels must exist exactly once, so the function may be
+   neither inlined nor cloned. */
+static size_t __attribute__ ((noinline, noclone))
+user_copy (void *dst, const void *src, size_t size) 
+{
+  size_t remaining;
+  int d0, d1, d2;
+
+  asm volatile ("user_copy_dwords:\n\t"
+                "rep movsl\n\t"
+                "movl %%edx, %%ecx\n"
+                "user_copy_bytes:\n\t"
+                "rep movsb\n"
+                "user_copy_done:"
+                : "=c" (remaining), "=D" (d0), "=S" (d1), "=d" (d2)
+                : "0" (size / 4), "1" (dst), "2" (src), "3" (size % 4)
+                : "memory");
+  return remaining;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.
+   Returns the number of bytes that could not be copied, which is
+   0 on success. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size) 
+{
+  if (!is_user_range (usrc, size))
+    return size;
+  return user_copy (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.
+   Returns the number of bytes that could not be copied, which is
+   0 on success. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size) 
+{
+  if (!is_user_range (udst, size))
+    return size;
+  return user_copy (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes.  The string is copied a
+   page at a time, so no bytes past the page holding its null
+   terminator are read.  Returns the length of the string, not
+   including the null terminator, or SIZE if the string did not
+   fit into DST, in which case DST is not null-terminated.
+   Returns -1 if USRC is not a valid user pointer. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size) 
+{
+  size_t copied = 0;
+
+  while (copied < size) 
+    {
+      const char *src = usrc + copied;
+      size_t chunk = PGSIZE - pg_ofs (src);
+      const char *nul;
+
+      if (chunk > size - copied)
+        chunk = size - copied;
+      if (copy_from_user (dst + copied, src, chunk) != 0)
+        return -1;
+
+      nul = memchr (dst + copied, '\0', chunk);
+      if (nul != NULL)
+        return nul - dst;
+      copied += chunk;
+    }
+  return size;
+}
+
+/* Called by the page fault handler for a kernel page fault on a
+   user address that cannot be brought in.  If the fault happened
+   while copying to or from user memory, makes the copy return the
+   number of bytes it did not copy and returns true.  Otherwise,
+   returns false. */
+bool
+usercopy_fixup (struct intr_frame *f) 
+{
+  const char *eip = (const char *) f->eip;
+
+  if (eip == user_copy_dwords)
+    f->ecx = f->ecx * 4 + f->edx;
+  else if (eip != user_copy_bytes)
+    return false;
+  f->eip = (void (*) (void)) user_copy_done;
+  return true;
+}
+
+/* Returns true if the SIZE bytes at UADDR all lie in user
+   memory. */
+static bool
+is_user_range (const void *uaddr, size_t size) 
+{
+  const uint8_t *start = uaddr;
+  const uint8_t *end = start + size;
+
+  return end >= start && (uintptr_t) end <= (uintptr_t) PHYS_BASE;
+}
@@ -2,19 +2,37 @@
 #include "vm/swap.h"
 #include "vm/page.h"
 #include "lib/debug.h"
+#include "devices/timer.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "userprog/pagedir.h"
+#include <syscall-nr.h>
+
+/* Working set tracking.
+   Every WS_SAMPLE_TICKS the frames referenced since the previous sample
+   are counted towards their owner's working set, and the number of pages
+   each process brought in during that window becomes its page-fault
+   frequency.  A process holding more frames than its working set allows
+   replaces its own pages instead of taking frames from everyone else. */
+#define WS_SAMPLE_TICKS (TIMER_FREQ / 2)  // Length of a sample window
+#define WS_MIN_FRAMES 16                  // Never limit a process below this many frames
+#define WS_SLACK_FRAMES 8                 // Frames allowed on top of the working set
+#define PFF_HIGH 32                       // Faults per window above which a process may grow
 
-static hash_hash_func frame_hash_func;
-static hash_less_func frame_hash_less;
 static struct frame *lookup_frame(void *frame_address);
-static struct frame *evict_frame(uint32_t *pagedir);
+static struct frame *evict_frame(struct thread *owner);
+static void ws_sample(void);
+static void ws_roll(struct thread *t);
+static size_t ws_limit(struct thread *t);
+
+// Frame table stored as a hash table keyed by frame_address
+struct ohash frame_table;
 
-// Frame table stored as a hash table
-struct hash frame_table;
+// Cache the frame structs are allocated from
+static struct slab_cache frame_cache;
 
 // Frame lock to be acquried when accessing frame table to avoid race conditions
 static struct lock frame_lock;
@@ -23,11 +41,16 @@ static struct lock frame_lock;
 static struct list frame_list;
 static struct list_elem *frame_pointer;
 
+// Current working set sample window and the tick it started at
+static unsigned ws_epoch;
+static int64_t ws_sample_start;
+
 // Initialise frame table
 void init_frames(void)
 {
+  slab_cache_init(&frame_cache, "frame", sizeof(struct frame), NULL);
   lock_init(&frame_lock);
-  hash_init(&frame_table, frame_hash_func, frame_hash_less, NULL);
+  ohash_init_int(&frame_table, offsetof(struct frame, frame_address));
   list_init(&frame_list);
   frame_pointer = NULL;
 }
@@ -37,18 +60,42 @@ void *get_new_frame(enum palloc_flags flag, void *page_address)
 {
   lock_acquire(&frame_lock);
 
-  struct frame *new_frame = malloc(sizeof(struct frame));
+  struct thread *t = thread_current();
+  ws_sample();
+  ws_roll(t);
+  t->page_faults++;
+  t->window_faults++;
+
+  struct frame *new_frame = slab_alloc(&frame_cache);
   new_frame->page_address = page_address;
 
   void *frame_address = palloc_get_page(PAL_USER | flag);
 
+  // Pages of exited processes may still be waiting for the reaper
+  if (frame_address == NULL && pagedir_reap())
+  {
+    frame_address = palloc_get_page(PAL_USER | flag);
+  }
+
   if (frame_address == NULL)
   {
-    struct frame *evicted_frame = evict_frame(thread_current()->pagedir);
+    // A process above its working set replaces its own pages first
+    struct frame *evicted_frame = NULL;
+    if (t->resident_frames > ws_limit(t))
+    {
+      evicted_frame = evict_frame(t);
+    }
+    if (evicted_frame == NULL)
+    {
+      evicted_frame = evict_frame(NULL);
+    }
+    if (evicted_frame == NULL)
+    {
+      PANIC ("No frame available for eviction");
+    }
     pagedir_clear_page(evicted_frame->thread->pagedir, evicted_frame->page_address);
 
-    bool is_dirty = pagedir_is_dirty(evicted_frame->thread->pagedir, evicted_frame->page_address) 
-      || pagedir_is_dirty(evicted_frame->thread->pagedir, evicted_frame->frame_address);
+    bool is_dirty = pagedir_is_dirty(evicted_frame->thread->pagedir, evicted_frame->page_address);
 
     uint32_t index = swap_write(evicted_frame->frame_address);
     struct supp_page_table *supt = evicted_frame->thread->supp_page_table;
@@ -63,12 +110,17 @@ void *get_new_frame(enum palloc_flags flag, void *page_address)
   }
 
   new_frame->frame_address = frame_address;
-  new_frame->thread = thread_current();
+  new_frame->thread = t;
   new_frame->used = true;
+  new_frame->referenced = false;
+  t->resident_frames++;
   // new_frame->file_info = file; /* for our attempt at sharing we passed in a (file_struct *file) to get_new_frame */
   // new_frame->num_shared_pages = 1;
 
-  hash_insert(&frame_table, &new_frame->hash_elem);
+  if (!ohash_insert(&frame_table, new_frame))
+  {
+    PANIC ("Out of memory growing the frame table");
+  }
   list_push_back(&frame_list, &new_frame->list_elem);
   
   lock_release(&frame_lock);
@@ -89,13 +141,18 @@ void destroy_frame (void *frame_address, bool palloc_free)
   // frame->num_shared_pages--;
   // if (frame->num_shared_pages <= 0) 
   // {
-  hash_delete (&frame_table, &frame->hash_elem);
+  ohash_delete (&frame_table, frame);
+  if (frame_pointer == &frame->list_elem)
+  {
+    frame_pointer = list_next(frame_pointer);
+  }
   list_remove(&frame->list_elem);
+  frame->thread->resident_frames--;
   if (palloc_free)
   {
     palloc_free_page (frame_address);
   }
-  free (frame);
+  slab_free (&frame_cache, frame);
   // }
 
   if (lock_set_by_func)
@@ -105,6 +162,32 @@ void destroy_frame (void *frame_address, bool palloc_free)
 }
 
 
+/* Remove every frame owned by thread T from the frame table in a single pass.
+   The frames' pages are not freed, they are released with T's page directory. */
+void destroy_thread_frames (struct thread *t)
+{
+  lock_acquire (&frame_lock);
+  struct list_elem *e = list_begin (&frame_list);
+  while (e != list_end (&frame_list))
+  {
+    struct frame *frame = list_entry (e, struct frame, list_elem);
+    e = list_next (e);
+    if (frame->thread != t)
+    {
+      continue;
+    }
+    if (frame_pointer == &frame->list_elem)
+    {
+      frame_pointer = e;
+    }
+    ohash_delete (&frame_table, frame);
+    list_remove (&frame->list_elem);
+    slab_free (&frame_cache, frame);
+  }
+  t->resident_frames = 0;
+  lock_release (&frame_lock);
+}
+
 /* Helper functions for frame table. */
 
 void set_used (void *frame_address, bool new_used)
@@ -114,60 +197,129 @@ void set_used (void *frame_address, bool new_used)
   lock_release (&frame_lock);
 }
 
+/* Pin the frame at FRAME_ADDRESS so that it cannot be evicted, provided it still holds
+   PAGE_ADDRESS of the current thread. Returns false if the page has been evicted. */
+bool pin_frame (void *frame_address, void *page_address)
+{
+  lock_acquire (&frame_lock);
+  struct frame *frame = frame_address != NULL ? lookup_frame (frame_address) : NULL;
+  bool pinned = frame != NULL && frame->thread == thread_current ()
+                && frame->page_address == page_address;
+  if (pinned)
+  {
+    frame->used = true;
+  }
+  lock_release (&frame_lock);
+  return pinned;
+}
+
+/* Fill STAT with the memory usage of thread T. */
+void frame_get_memstat (struct thread *t, struct memstat *stat)
+{
+  lock_acquire (&frame_lock);
+  ws_roll (t);
+  stat->resident = t->resident_frames;
+  stat->working_set = t->working_set;
+  stat->faults = t->page_faults;
+  stat->fault_rate = t->fault_rate;
+  lock_release (&frame_lock);
+}
+
 // Choose a frame to evict when frame table is full using the second chance algorithm.
-static struct frame *evict_frame(uint32_t *pagedir)
+// If OWNER is not NULL only frames belonging to OWNER are considered.
+static struct frame *evict_frame(struct thread *owner)
 {
   size_t size = list_size(&frame_list);
 
-  if (frame_pointer == NULL)
-  {
-    frame_pointer = list_begin(&frame_list);
-  }
   for (uint32_t i = 0; i < 2 * size; i++)
   {
-    struct frame *frame = list_entry(frame_pointer, struct frame, list_elem);
-
-    if (frame_pointer == list_end(&frame_list))
+    if (frame_pointer == NULL || frame_pointer == list_end(&frame_list))
     {
       frame_pointer = list_begin(&frame_list);
     }
-    else
-    {
-      frame_pointer = list_next(frame_pointer);
-    }
+    struct frame *frame = list_entry(frame_pointer, struct frame, list_elem);
+    frame_pointer = list_next(frame_pointer);
 
-    if (frame->used)
+    if (frame->used || (owner != NULL && frame->thread != owner))
     {
       continue;
     }
+    uint32_t *pagedir = frame->thread->pagedir;
     if (!pagedir_is_accessed(pagedir, frame->page_address))
     {
       return frame;
     }
     pagedir_set_accessed(pagedir, frame->page_address, false);
+    frame->referenced = true;
   }
 
   return NULL;
 }
 
-// Lookup a frame in the hash table via its frame_address
-static struct frame *lookup_frame(void *frame_address)
+// Start a new working set sample window if the current one has run out.
+// Must be called with frame_lock held.
+static void ws_sample(void)
 {
-  struct frame search_frame;
-  search_frame.frame_address = frame_address;
-  struct hash_elem *frame_elem = hash_find(&frame_table, &search_frame.hash_elem);
-  return hash_entry(frame_elem, struct frame, hash_elem);
+  if (timer_elapsed(ws_sample_start) < WS_SAMPLE_TICKS)
+  {
+    return;
+  }
+  ws_sample_start = timer_ticks();
+  ws_epoch++;
+
+  struct list_elem *e;
+  for (e = list_begin(&frame_list); e != list_end(&frame_list); e = list_next(e))
+  {
+    ws_roll(list_entry(e, struct frame, list_elem)->thread);
+  }
+
+  // Count the frames referenced during the window that just ended
+  for (e = list_begin(&frame_list); e != list_end(&frame_list); e = list_next(e))
+  {
+    struct frame *frame = list_entry(e, struct frame, list_elem);
+    uint32_t *pagedir = frame->thread->pagedir;
+    if (frame->referenced || pagedir_is_accessed(pagedir, frame->page_address))
+    {
+      frame->thread->working_set++;
+      pagedir_set_accessed(pagedir, frame->page_address, false);
+    }
+    frame->referenced = false;
+  }
+}
+
+// Move the statistics of thread T into the current sample window.
+// Must be called with frame_lock held.
+static void ws_roll(struct thread *t)
+{
+  if (t->ws_epoch == ws_epoch)
+  {
+    return;
+  }
+  t->fault_rate = t->ws_epoch + 1 == ws_epoch ? t->window_faults : 0;
+  t->window_faults = 0;
+  t->working_set = 0;
+  t->ws_epoch = ws_epoch;
 }
 
-static unsigned frame_hash_func(const struct hash_elem *elem, void *aux UNUSED)
+// The number of frames thread T may hold before it has to replace its own pages
+static size_t ws_limit(struct thread *t)
 {
-  struct frame *frame = hash_entry(elem, struct frame, hash_elem);
-  return hash_bytes(&frame->frame_address, sizeof(frame->frame_address));
+  // Nothing is known about a process until it has been sampled
+  if (t->working_set == 0)
+  {
+    return SIZE_MAX;
+  }
+
+  size_t limit = t->working_set + WS_SLACK_FRAMES;
+  if (t->fault_rate > PFF_HIGH)
+  {
+    limit += t->working_set;
+  }
+  return limit < WS_MIN_FRAMES ? WS_MIN_FRAMES : limit;
 }
 
-static bool frame_hash_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+// Lookup a frame in the hash table via its frame_address
+static struct frame *lookup_frame(void *frame_address)
 {
-  struct frame *frame_a = hash_entry(a, struct frame, hash_elem);
-  struct frame *frame_b = hash_entry(b, struct frame, hash_elem);
-  return frame_a->frame_address < frame_b->frame_address;
-}
\ No newline at end of file
+  return ohash_find_int(&frame_table, (uintptr_t) frame_address);
+}
@@ -1,9 +1,13 @@
 #include "lib/debug.h"
 #include "vm/page.h"
 #include "vm/frame.h"
+#include "threads/init.h"
 #include "threads/malloc.h"
+#include "threads/pte.h"
+#include "threads/slab.h"
 #include "userprog/syscall.h"
 #include "threads/vaddr.h"
+#include <round.h>
 #include <string.h>
 #include "userprog/pagedir.h"
 #include "filesys/file.h"
@@ -11,9 +15,21 @@
 #include "threads/thread.h"
 #include "vm/swap.h"
 
-static hash_hash_func supp_hash_func;
-static hash_less_func supp_hash_less;
-static hash_action_func supp_destroy_func;
+static ohash_action_func supp_destroy_func;
+static void write_back_run (struct supp_page_table *supp_page_table, uint32_t *pagedir,
+    void *addr, struct file *f, size_t offset, size_t bytes);
+static void remove_page (struct supp_page_table *supp_page_table, struct page *page);
+
+// Caches the page and file_struct entries are allocated from
+static struct slab_cache page_cache;
+static struct slab_cache file_struct_cache;
+
+/* Initialise the caches for supplemental page table entries. */
+void init_pages (void)
+{
+  slab_cache_init (&page_cache, "page", sizeof (struct page), NULL);
+  slab_cache_init (&file_struct_cache, "file_struct", sizeof (struct file_struct), NULL);
+}
 
 /* Create supplemental page table */
 struct supp_page_table *init_supp_page_table (void)
@@ -28,7 +44,7 @@ struct supp_page_table *init_supp_page_table (void)
   }
   
   // Initialise the supplemental page table.
-  hash_init (&supp_page_table->page_table, supp_hash_func, supp_hash_less, NULL);
+  ohash_init_int (&supp_page_table->page_table, offsetof (struct page, address));
 
   return supp_page_table;
 }
@@ -36,14 +52,14 @@ struct supp_page_table *init_supp_page_table (void)
 /* Destroy supplemental page table. */
 void destroy_supp_pt (struct supp_page_table *supp_page_table)
 {
-  hash_destroy (&supp_page_table->page_table, supp_destroy_func);
+  ohash_destroy (&supp_page_table->page_table, supp_destroy_func);
   free (supp_page_table);
 }
 
 /* Add a page to the supp_page_table with it's specified page_loc and file_info if page is from an EXECFILE. */ 
 bool add_supp_pt (struct supp_page_table *supp_page_table, void *addr, void *faddr, enum page_loc from, struct file_struct *file_info)
 {
-  struct page *page = (struct page *) malloc(sizeof(struct page));
+  struct page *page = slab_alloc (&page_cache);
   if (!page)
   {
     exit_exception ();
@@ -56,12 +72,10 @@ bool add_supp_pt (struct supp_page_table *supp_page_table, void *addr, void *fad
   page->dirty_bit = false;
   page->file_info = file_info;
 
-  struct hash_elem *old = hash_insert (&supp_page_table->page_table, &page->elem);
-  // Return true and replace old page if the page already exists.
-  if (old) 
+  struct page *old_page = find_page (supp_page_table, addr);
+  // Replace the old page if the page already exists.
+  if (old_page) 
   {
-    struct page *old_page = hash_entry (old, struct page, elem);
-
     page->file_info->file_writeable = old_page->file_info->file_writeable || page->file_info->file_writeable;
     if (old_page->page_from == FRAME)
     {
@@ -69,10 +83,14 @@ bool add_supp_pt (struct supp_page_table *supp_page_table, void *addr, void *fad
     }
     else if (old_page->page_from == EXECFILE)
     {
-      free (old_page->file_info);
+      slab_free (&file_struct_cache, old_page->file_info);
     }
     pagedir_clear_page (thread_current()->pagedir, old_page->address);
-    hash_replace (&supp_page_table->page_table, &page->elem);
+    ohash_delete (&supp_page_table->page_table, old_page);
+  }
+  if (!ohash_insert (&supp_page_table->page_table, page))
+  {
+    exit_exception ();
   }
   return true;
 }
@@ -90,6 +108,46 @@ bool add_zero_supp_pt (struct supp_page_table *supp_page_table, void *addr)
   return add_supp_pt (supp_page_table, addr, NULL, ZERO, NULL);
 }
 
+/* Map the PTSPAN-aligned, PTSPAN-byte region of zeros at ADDR with a single large page
+   and add its pages to the supplemental page table as LARGE.  The region stays resident
+   until the process exits, so it never faults and saves the page table and TLB entries
+   of 1024 small pages.  Returns false, with nothing mapped, if the CPU lacks large pages
+   or the user pool has no free physically aligned 4 MB. */
+bool add_large_supp_pt (struct supp_page_table *supp_page_table, uint32_t *pagedir, void *addr)
+{
+  const size_t page_cnt = PTSPAN / PGSIZE;
+
+  ASSERT ((uintptr_t) addr % PTSPAN == 0);
+  if (!init_large_pages)
+  {
+    return false;
+  }
+
+  // The page allocator only aligns runs within its pool, so take twice as much as needed
+  // and give back what lies either side of the aligned 4 MB in it.
+  uint8_t *run = palloc_get_multiple (PAL_USER, 2 * page_cnt - 1);
+  if (!run)
+  {
+    return false;
+  }
+  uint8_t *kpage = ptov (ROUND_UP (vtop (run), PTSPAN));
+  size_t head_cnt = (kpage - run) / PGSIZE;
+  palloc_free_multiple (run, head_cnt);
+  palloc_free_multiple (kpage + PTSPAN, page_cnt - 1 - head_cnt);
+
+  memset (kpage, 0, PTSPAN);
+  if (!pagedir_set_large_page (pagedir, addr, kpage, true))
+  {
+    palloc_free_multiple (kpage, page_cnt);
+    return false;
+  }
+  for (size_t i = 0; i < page_cnt; i++)
+  {
+    add_supp_pt (supp_page_table, addr + i * PGSIZE, kpage + i * PGSIZE, LARGE, NULL);
+  }
+  return true;
+}
+
 /* Get a page from the supp_page_table and prepare it for swapping. */
 bool set_swap_supp_pt (struct supp_page_table *supp_page_table, void *page_addr, uint32_t swap_index)
 {
@@ -109,7 +167,7 @@ bool set_swap_supp_pt (struct supp_page_table *supp_page_table, void *page_addr,
 bool add_file_supp_pt (struct supp_page_table *supp_page_table, void *addr,
     struct file *file, int32_t start_byte, uint32_t read_bytes, uint32_t zero_bytes, bool writeable)
 {
-  struct file_struct *file_info = (struct file_struct *) malloc(sizeof(struct file_struct));
+  struct file_struct *file_info = slab_alloc (&file_struct_cache);
   file_info->file = file;
   file_info->file_start_byte = start_byte;
   file_info->file_read_bytes = read_bytes;
@@ -122,25 +180,15 @@ bool add_file_supp_pt (struct supp_page_table *supp_page_table, void *addr,
    If found it returns the page address, else returns NULL. */
 struct page *find_page (struct supp_page_table *supp_page_table, void *page)
 {
-  // Create a page with the same hash key
-  struct page temp_page;
-  temp_page.address = page;
-
-  struct hash_elem *e = hash_find (&supp_page_table->page_table, &temp_page.elem);
-  if (!e) 
-  {
-    return NULL;
-  }
-
-  return hash_entry (e, struct page, elem);
+  return ohash_find_int (&supp_page_table->page_table, (uintptr_t) page);
 }
 
 /* Load page back on frame (into the memory). */
 bool load_page (struct page *page, uint32_t *pagedir, void *address)
 {
-  // If the page has already been loaded it will be on FRAME
+  // If the page has already been loaded it will be on FRAME or in a large page
   // Else the page will be put in a new frame
-  if(page->page_from == FRAME) 
+  if(page->page_from == FRAME || page->page_from == LARGE) 
   {  
     return true;
   }
@@ -168,7 +216,8 @@ bool load_page (struct page *page, uint32_t *pagedir, void *address)
   }
   */
 
-  void *frame_page = get_new_frame(PAL_USER, address);
+  // Zero-fill pages come from the pre-zeroed pool when possible
+  void *frame_page = get_new_frame(PAL_USER | (page->page_from == ZERO ? PAL_ZERO : 0), address);
   if(!frame_page) 
   {
     return false;
@@ -179,7 +228,7 @@ bool load_page (struct page *page, uint32_t *pagedir, void *address)
   switch (page->page_from)
   {
     case ZERO:
-      memset (frame_page, 0, PGSIZE);
+      // Already zeroed by palloc
       break;
 
     case SWAP:
@@ -215,107 +264,169 @@ bool load_page (struct page *page, uint32_t *pagedir, void *address)
 
   page->faddress = frame_page;
   page->page_from = FRAME;
-  pagedir_set_dirty (pagedir, frame_page, false);
 
   return true;
 }
 
-
-bool unmap_supp_pt(struct supp_page_table *supp_page_table, uint32_t *pagedir,
-    void *addr, struct file *f, uint32_t offset, size_t bytes)
+/* Load PAGE into memory and pin its frame so that it cannot be evicted
+   until unpin_page is called. */
+bool pin_page (struct page *page, uint32_t *pagedir)
 {
-  struct page *page = find_page (supp_page_table, addr);
-  if (page == NULL) 
+  // Large pages are never evicted and have no frame to pin
+  if (page->page_from == LARGE)
   {
-    PANIC ("munmap - page is missing");
+    return true;
   }
 
-  if (page->page_from == FRAME) 
+  // The page may be evicted again before its frame is pinned
+  do
   {
-    set_used (page->faddress, true);
+    if (!load_page (page, pagedir, page->address))
+    {
+      return false;
+    }
   }
+  while (!pin_frame (page->faddress, page->address));
+  return true;
+}
 
-  switch (page->page_from)
+/* Allow the frame of a page pinned by pin_page to be evicted again. */
+void unpin_page (struct page *page)
+{
+  if (page->page_from == FRAME)
   {
-    case FRAME:
-    {
-      // if address or mapped frame is dirty, write to file
-      bool is_dirty = page->dirty_bit;
-      is_dirty = is_dirty || pagedir_is_dirty(pagedir, page->address);
-      is_dirty = is_dirty || pagedir_is_dirty(pagedir, page->faddress);
-      if (is_dirty) 
-      {
-        file_write_at (f, page->address, bytes, offset);
-      }
+    set_used (page->faddress, false);
+  }
+}
 
-      // destroy frame and clear page mapping
-      destroy_frame (page->faddress, true);
-      pagedir_clear_page (pagedir, page->address);
+/* Unmaps the SIZE bytes of file F that are mapped at ADDR, writing modified pages back to F.
+   Adjacent modified pages that are in memory are written back with a single file_write_at. */
+bool unmap_supp_pt(struct supp_page_table *supp_page_table, uint32_t *pagedir,
+    void *addr, struct file *f, size_t size)
+{
+  // Modified pages in memory waiting to be written back, from run_start to run_start + run_bytes.
+  // They stay mapped and pinned until the run is written.
+  size_t run_start = 0;
+  size_t run_bytes = 0;
+
+  for (size_t offset = 0; offset < size; offset += PGSIZE)
+  {
+    size_t bytes = size - offset < PGSIZE ? size - offset : PGSIZE;
+    struct page *page = find_page (supp_page_table, addr + offset);
+    if (page == NULL) 
+    {
+      PANIC ("munmap - page is missing");
     }
-      break;
 
-    case SWAP:
+    switch (page->page_from)
     {
-      bool is_dirty = page->dirty_bit;
-      is_dirty = is_dirty || pagedir_is_dirty(pagedir, page->address);
-      if (is_dirty) 
+      case FRAME:
       {
-        // load from swap and write back to file
-        void *temp_page = palloc_get_page(0);
-        swap_read (page->swap_index, temp_page);
-        file_write_at (f, temp_page, PGSIZE, offset);
-        palloc_free_page (temp_page);
+        set_used (page->faddress, true);
+
+        // if the page has been written to, add it to the run to write back
+        bool is_dirty = page->dirty_bit;
+        is_dirty = is_dirty || pagedir_is_dirty(pagedir, page->address);
+        if (is_dirty) 
+        {
+          if (run_bytes > 0 && run_start + run_bytes != offset)
+          {
+            write_back_run (supp_page_table, pagedir, addr, f, run_start, run_bytes);
+            run_bytes = 0;
+          }
+          if (run_bytes == 0)
+          {
+            run_start = offset;
+          }
+          run_bytes += bytes;
+          continue;
+        }
+
+        // destroy frame and clear page mapping
+        destroy_frame (page->faddress, true);
+        pagedir_clear_page (pagedir, page->address);
       }
-      else 
+        break;
+
+      case SWAP:
       {
-        free_swap (page->swap_index);
+        bool is_dirty = page->dirty_bit;
+        is_dirty = is_dirty || pagedir_is_dirty(pagedir, page->address);
+        if (is_dirty) 
+        {
+          // load from swap and write back to file
+          void *temp_page = palloc_get_page(0);
+          swap_read (page->swap_index, temp_page);
+          file_write_at (f, temp_page, bytes, offset);
+          palloc_free_page (temp_page);
+        }
+        else 
+        {
+          free_swap (page->swap_index);
+        }
       }
-    }
-      break;
+        break;
 
-    case EXECFILE:
-      break;
+      case EXECFILE:
+        break;
 
-    default:
-      PANIC ("unreachable state");
+      default:
+        PANIC ("unreachable state");
+    }
+
+    remove_page (supp_page_table, page);
   }
 
-  // remove supplementary page table so unmapped memory is unreachable
-  hash_delete(&supp_page_table->page_table, &page->elem);
+  if (run_bytes > 0)
+  {
+    write_back_run (supp_page_table, pagedir, addr, f, run_start, run_bytes);
+  }
   return true;
 }
 
-/* Helper functions for the supplemental page table hash map. */
-
-static unsigned supp_hash_func(const struct hash_elem *elem, void *aux UNUSED)
+/* Writes the BYTES bytes of the mapping of F at ADDR starting at OFFSET back to F,
+   then frees the frames holding them. The pages must be in memory and pinned. */
+static void write_back_run (struct supp_page_table *supp_page_table, uint32_t *pagedir,
+    void *addr, struct file *f, size_t offset, size_t bytes)
 {
-  struct page *page = hash_entry (elem, struct page, elem);
-  return hash_int((int) page->address);
+  file_write_at (f, addr + offset, bytes, offset);
+
+  for (size_t page_ofs = 0; page_ofs < bytes; page_ofs += PGSIZE)
+  {
+    struct page *page = find_page (supp_page_table, addr + offset + page_ofs);
+    destroy_frame (page->faddress, true);
+    pagedir_clear_page (pagedir, page->address);
+    remove_page (supp_page_table, page);
+  }
 }
 
-static bool supp_hash_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+/* Remove PAGE from the supplementary page table so unmapped memory is unreachable. */
+static void remove_page (struct supp_page_table *supp_page_table, struct page *page)
 {
-  struct page *page_a = hash_entry (a, struct page, elem);
-  struct page *page_b = hash_entry (b, struct page, elem);
-  return page_a->address < page_b->address;
+  ohash_delete (&supp_page_table->page_table, page);
+  if (page->file_info != NULL)
+  {
+    slab_free (&file_struct_cache, page->file_info);
+  }
+  slab_free (&page_cache, page);
 }
 
-static void supp_destroy_func (struct hash_elem *e, void *aux UNUSED)
+/* Helper functions for the supplemental page table hash map. */
+
+static void supp_destroy_func (void *e, void *aux UNUSED)
 {
-  struct page *page = hash_entry (e, struct page, elem);
+  struct page *page = e;
 
-  // Check the page_from and free based on the location
-  if (page->page_from == FRAME)
-  {
-    destroy_frame (page->faddress, false);
-  }
-  else if (page->page_from == EXECFILE)
+  // Check the page_from and free based on the location.
+  // Frames have already been released by destroy_thread_frames and
+  // their pages, like large pages, are freed along with the page directory.
+  if (page->page_from == EXECFILE)
   {
-    free (page->file_info);
+    slab_free (&file_struct_cache, page->file_info);
   }
   else if (page->page_from == SWAP) 
   {
     free_swap (page->swap_index);
   }
-  free (page);
+  slab_free (&page_cache, page);
 }
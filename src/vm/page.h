@@ -1,12 +1,10 @@
 #ifndef VM_PAGE_H
 #define VM_PAGE_H
 
-#include <hash.h>
-#include "lib/kernel/hash.h"
+#include "lib/kernel/ohash.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <hash.h>
 
 /* The different locations/states
    the page can be in. */
@@ -15,13 +13,14 @@ enum page_loc
   FRAME, /* In memory. */
   ZERO, /* Zeros. */
   SWAP, /* In swap slot. */
-  EXECFILE /* In filesys/executable. */
+  EXECFILE, /* In filesys/executable. */
+  LARGE /* In a resident large page, never evicted. */
 };
 
 struct supp_page_table 
 {
-  /* Map from page to the supplemental page table entry. */
-  struct hash page_table;
+  /* Map from page address to the supplemental page table entry. */
+  struct ohash page_table;
 };
 
 /* A page is an entry of the supp_page_table. */
@@ -37,8 +36,6 @@ struct page
 
   // When page loc is FILE
   struct file_struct *file_info;
-
-  struct hash_elem elem; 
 };
 
 /* Struct for a file, containing all necessary information for that file */
@@ -51,17 +48,21 @@ struct file_struct
   bool file_writeable;  /* Is file writeable (based on segment being read). */
 };
 
+void init_pages (void);
 struct supp_page_table *init_supp_page_table (void);
 void destroy_supp_pt (struct supp_page_table *supp_page_table);
 bool add_frame_supp_pt (struct supp_page_table *supp_page_table, void *addr, void *faddr);
 bool add_zero_supp_pt (struct supp_page_table *supp_page_table, void *addr);
+bool add_large_supp_pt (struct supp_page_table *supp_page_table, uint32_t *pagedir, void *addr);
 bool set_swap_supp_pt (struct supp_page_table *supp_page_table, void *page_addr, uint32_t swap_index);
 bool add_file_supp_pt (struct supp_page_table *supp_page_table, void *addr,
     struct file *file, int32_t start_byte, uint32_t read_bytes, uint32_t zero_bytes, bool writeable);
 struct page *find_page (struct supp_page_table *supp_page_table, void *page);
 bool load_page (struct page *page, uint32_t *pagedir, void *address);
+bool pin_page (struct page *page, uint32_t *pagedir);
+void unpin_page (struct page *page);
 bool add_supp_pt (struct supp_page_table *supp_page_table, void *addr, void *faddr, enum page_loc from, struct file_struct *file_info);
 bool unmap_supp_pt(struct supp_page_table *supp_page_table, uint32_t *pagedir,
-    void *addr, struct file *f, uint32_t offset, size_t bytes);
+    void *addr, struct file *f, size_t size);
 
 #endif
\ No newline at end of file
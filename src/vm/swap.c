@@ -1,4 +1,5 @@
 #include "vm/swap.h"
+#include "vm/zswap.h"
 #include "devices/block.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
@@ -7,20 +8,23 @@
 #include <stdio.h>
 
 #define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE) // Number of sectors an individual page takes up in block_swap
+#define SWAP_IN_ZSWAP 0x80000000 // Set in a swap index whose page lives in the compressed pool, see vm/zswap.c
 
 static struct block *block_swap; // A block where all pages in the swap table are written to, read from, and freed
 static struct bitmap *swap_bitmap; // Bitmap for checking availiable swap slots
 static size_t swap_table_size; // The size of the swap table (number of swap slots)
 struct lock swap_lock; // Swap table lock to prevent race conditions
+static unsigned long long disk_write_cnt; // Number of pages written to block_swap
 
-// Initialise the swap table
-void swap_init (void) 
+// Initialise the swap table, with a compressed pool of up to ZSWAP_PAGES kernel pages in front of it
+void swap_init (size_t zswap_pages) 
 {
   block_swap = block_get_role(BLOCK_SWAP);
   swap_table_size = block_size(block_swap) / SECTORS_PER_PAGE;
   swap_bitmap = bitmap_create(swap_table_size);
   bitmap_set_all(swap_bitmap, true);
   lock_init(&swap_lock);
+  zswap_init(zswap_pages);
 }
 
 // Read the content from the swap index, and store into "page"
@@ -28,6 +32,14 @@ void swap_read (uint32_t swap_index, void *page)
 {
   // Assert that the page and swap index are both valid  
   ASSERT (page >= PHYS_BASE);
+
+  // Pages in the compressed pool never touch the disk
+  if (swap_index & SWAP_IN_ZSWAP)
+  {
+    zswap_load(swap_index & ~SWAP_IN_ZSWAP, page);
+    return;
+  }
+
   ASSERT (swap_index < swap_table_size);
 
   lock_acquire(&swap_lock);
@@ -58,6 +70,13 @@ uint32_t swap_write (void *page)
   // Assert that the page is valid
   ASSERT (page >= PHYS_BASE);
 
+  // Try the compressed pool first, it falls back to disk when full or the page is incompressible
+  uint32_t slot;
+  if (zswap_store(page, &slot))
+  {
+    return slot | SWAP_IN_ZSWAP;
+  }
+
   lock_acquire(&swap_lock);
 
   /* 
@@ -79,6 +98,7 @@ uint32_t swap_write (void *page)
   {
     block_write(block_swap, swap_index * SECTORS_PER_PAGE + i, page + BLOCK_SECTOR_SIZE * i);
   }
+  disk_write_cnt++;
 
   lock_release(&swap_lock);
 
@@ -88,6 +108,12 @@ uint32_t swap_write (void *page)
 // Free a swap slot
 void free_swap (uint32_t swap_index) 
 {
+  if (swap_index & SWAP_IN_ZSWAP)
+  {
+    zswap_free(swap_index & ~SWAP_IN_ZSWAP);
+    return;
+  }
+
   // Assert that the swap index is valid
   ASSERT (swap_index < swap_table_size);
   // Assert that the swap slot is not empty  
@@ -101,3 +127,9 @@ void free_swap (uint32_t swap_index)
   bitmap_set(swap_bitmap, swap_index, true);
 }
 
+// Print swap statistics
+void swap_print_stats (void)
+{
+  printf ("Swap: %llu pages written to disk\n", disk_write_cnt);
+  zswap_print_stats();
+}
@@ -1,12 +1,14 @@
 #ifndef VM_SWAP_H
 #define VM_SWAP_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <inttypes.h>
 
-void swap_init (void);
+void swap_init (size_t zswap_pages);
 void swap_read (uint32_t swap_index, void *page);
 uint32_t swap_write (void *page);
 void free_swap (uint32_t swap_index);
+void swap_print_stats (void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,412 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed in-memory swap pool.
+
+   Evicted pages are compressed with a small LZ77 codec (an LZ4-style
+   token stream) and stored in kernel pages taken from palloc's kernel
+   pool.  Each pool page is carved into ZSWAP_CHUNK_SIZE byte chunks,
+   and a compressed page occupies a run of chunks that never crosses a
+   pool page boundary.  A stored page is identified by the index of its
+   first chunk. */
+
+#define ZSWAP_CHUNK_SIZE 64                              // Allocation unit inside a pool page
+#define CHUNKS_PER_PAGE (PGSIZE / ZSWAP_CHUNK_SIZE)      // Number of chunks in one pool page
+#define ZSWAP_MAX_CHUNKS (CHUNKS_PER_PAGE * 3 / 4)       // Pages compressing worse than this go to disk
+
+#define LZ_MIN_MATCH 4      // Shortest match worth encoding
+#define LZ_HASH_BITS 12     // log2 of the number of match finder hash buckets
+
+static size_t pool_page_limit; // Maximum number of kernel pages the pool may hold
+static size_t pool_page_cnt; // Number of kernel pages currently in the pool
+static uint8_t **pool_pages; // Kernel pages holding compressed data
+static struct bitmap *chunk_map; // Chunk usage, true if used or not yet backed by a pool page
+static uint8_t *chunk_cnt; // Length in chunks of the page stored at each start chunk
+static struct lock zswap_lock; // Protects the pool and the scratch buffers below
+
+// Scratch space for the codec, only used with zswap_lock held
+static uint16_t lz_hash_table[1 << LZ_HASH_BITS];
+static uint8_t lz_buffer[ZSWAP_MAX_CHUNKS * ZSWAP_CHUNK_SIZE];
+
+// Statistics
+static unsigned long long stored_cnt; // Pages stored in the pool
+static unsigned long long rejected_cnt; // Pages that did not compress well enough
+static unsigned long long full_cnt; // Pages turned away because the pool was full
+
+static size_t alloc_chunks (size_t cnt);
+static uint8_t *chunk_address (size_t chunk);
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_size);
+static bool lz_decompress (const uint8_t *src, size_t src_size, uint8_t *dst);
+
+// Initialise the pool, allowing it to grow to PAGE_LIMIT kernel pages (0 disables it)
+void zswap_init (size_t page_limit)
+{
+  lock_init (&zswap_lock);
+  pool_page_limit = page_limit;
+  pool_page_cnt = 0;
+  if (page_limit == 0)
+  {
+    return;
+  }
+
+  pool_pages = malloc (page_limit * sizeof *pool_pages);
+  chunk_map = bitmap_create (page_limit * CHUNKS_PER_PAGE);
+  chunk_cnt = calloc (page_limit * CHUNKS_PER_PAGE, sizeof *chunk_cnt);
+  if (pool_pages == NULL || chunk_map == NULL || chunk_cnt == NULL)
+  {
+    PANIC ("Not enough memory for a %zu page zswap pool", page_limit);
+  }
+
+  // No chunk is usable until a pool page has been allocated for it
+  bitmap_set_all (chunk_map, true);
+}
+
+/* Compress "page" into the pool and store its slot in *SLOT.
+   Returns false if the pool is disabled or full, or if the page does not
+   compress well enough, in which case the caller should swap to disk. */
+bool zswap_store (const void *page, uint32_t *slot)
+{
+  if (pool_page_limit == 0)
+  {
+    return false;
+  }
+
+  lock_acquire (&zswap_lock);
+
+  size_t bytes = lz_compress (page, lz_buffer, sizeof lz_buffer);
+  if (bytes == 0)
+  {
+    rejected_cnt++;
+    lock_release (&zswap_lock);
+    return false;
+  }
+
+  size_t cnt = DIV_ROUND_UP (bytes, ZSWAP_CHUNK_SIZE);
+  size_t chunk = alloc_chunks (cnt);
+  if (chunk == BITMAP_ERROR)
+  {
+    full_cnt++;
+    lock_release (&zswap_lock);
+    return false;
+  }
+
+  memcpy (chunk_address (chunk), lz_buffer, bytes);
+  chunk_cnt[chunk] = cnt;
+  stored_cnt++;
+
+  lock_release (&zswap_lock);
+
+  *slot = chunk;
+  return true;
+}
+
+// Decompress the page in SLOT into "page" and release the slot
+void zswap_load (uint32_t slot, void *page)
+{
+  ASSERT (slot < pool_page_cnt * CHUNKS_PER_PAGE);
+
+  lock_acquire (&zswap_lock);
+
+  if (chunk_cnt[slot] == 0)
+  {
+    lock_release (&zswap_lock);
+    PANIC ("Attempted to read from empty zswap slot");
+    return;
+  }
+
+  if (!lz_decompress (chunk_address (slot), chunk_cnt[slot] * ZSWAP_CHUNK_SIZE, page))
+  {
+    lock_release (&zswap_lock);
+    PANIC ("Corrupt page in zswap slot %"PRIu32, slot);
+    return;
+  }
+
+  lock_release (&zswap_lock);
+
+  zswap_free (slot);
+}
+
+// Release a slot in the pool
+void zswap_free (uint32_t slot)
+{
+  ASSERT (slot < pool_page_cnt * CHUNKS_PER_PAGE);
+
+  bool lock_set_by_func = false;
+  if (!lock_held_by_current_thread (&zswap_lock))
+  {
+    lock_acquire (&zswap_lock);
+    lock_set_by_func = true;
+  }
+
+  if (chunk_cnt[slot] == 0)
+  {
+    PANIC ("Attempted to free an empty zswap slot");
+    return;
+  }
+
+  bitmap_set_multiple (chunk_map, slot, chunk_cnt[slot], false);
+  chunk_cnt[slot] = 0;
+
+  if (lock_set_by_func)
+  {
+    lock_release (&zswap_lock);
+  }
+}
+
+// Print statistics about the compressed pool
+void zswap_print_stats (void)
+{
+  if (pool_page_limit == 0)
+  {
+    return;
+  }
+
+  printf ("Zswap: %llu pages compressed, %llu incompressible, %llu rejected (pool full), %zu/%zu pool pages\n",
+          stored_cnt, rejected_cnt, full_cnt, pool_page_cnt, pool_page_limit);
+}
+
+/* Helper functions for the pool. */
+
+/* Find CNT free chunks within a single pool page, growing the pool if
+   needed, and mark them used.  Returns the first chunk or BITMAP_ERROR. */
+static size_t alloc_chunks (size_t cnt)
+{
+  size_t start = 0;
+  for (;;)
+  {
+    size_t chunk = bitmap_scan (chunk_map, start, cnt, false);
+    if (chunk == BITMAP_ERROR)
+    {
+      break;
+    }
+
+    // A run that crosses into the next pool page is not contiguous in memory
+    size_t page_end = ROUND_UP (chunk + 1, CHUNKS_PER_PAGE);
+    if (chunk + cnt <= page_end)
+    {
+      bitmap_set_multiple (chunk_map, chunk, cnt, true);
+      return chunk;
+    }
+    start = page_end;
+  }
+
+  if (pool_page_cnt == pool_page_limit)
+  {
+    return BITMAP_ERROR;
+  }
+
+  uint8_t *kpage = palloc_get_page (0);
+  if (kpage == NULL)
+  {
+    return BITMAP_ERROR;
+  }
+
+  size_t chunk = pool_page_cnt * CHUNKS_PER_PAGE;
+  pool_pages[pool_page_cnt++] = kpage;
+  bitmap_set_multiple (chunk_map, chunk + cnt, CHUNKS_PER_PAGE - cnt, false);
+  return chunk;
+}
+
+// Kernel address of a chunk
+static uint8_t *chunk_address (size_t chunk)
+{
+  return pool_pages[chunk / CHUNKS_PER_PAGE] + (chunk % CHUNKS_PER_PAGE) * ZSWAP_CHUNK_SIZE;
+}
+
+/* LZ codec.
+
+   The compressed stream is a sequence of tokens.  The high nibble of a
+   token is the number of literal bytes that follow it, the low nibble is
+   the match length minus LZ_MIN_MATCH, and a nibble of 15 means the
+   length continues in following bytes, each adding up to 255.  The
+   literals are followed by a two byte little-endian match offset.  The
+   final token only carries literals, since the decoder stops once a
+   whole page has been produced. */
+
+static uint32_t lz_read32 (const uint8_t *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static unsigned lz_hash (uint32_t seq)
+{
+  return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t *lz_put_length (uint8_t *op, size_t len)
+{
+  for (; len >= 255; len -= 255)
+  {
+    *op++ = 255;
+  }
+  *op++ = len;
+  return op;
+}
+
+static bool lz_get_length (const uint8_t **ip, const uint8_t *ip_end, size_t *len)
+{
+  uint8_t byte;
+  do
+  {
+    if (*ip >= ip_end)
+    {
+      return false;
+    }
+    byte = *(*ip)++;
+    *len += byte;
+  }
+  while (byte == 255);
+  return true;
+}
+
+/* Append a sequence of LIT_LEN literals from LIT followed by a match of
+   MATCH_LEN bytes at distance OFFSET (no match if MATCH_LEN is 0).
+   Returns the new output position, or NULL if OP_END would be passed. */
+static uint8_t *lz_emit (uint8_t *op, uint8_t *op_end, const uint8_t *lit,
+    size_t lit_len, size_t offset, size_t match_len)
+{
+  size_t worst = 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1;
+  if ((size_t) (op_end - op) < worst)
+  {
+    return NULL;
+  }
+
+  uint8_t *token = op++;
+  *token = (lit_len < 15 ? lit_len : 15) << 4;
+  if (lit_len >= 15)
+  {
+    op = lz_put_length (op, lit_len - 15);
+  }
+  memcpy (op, lit, lit_len);
+  op += lit_len;
+
+  if (match_len == 0)
+  {
+    return op;
+  }
+
+  *op++ = offset & 0xff;
+  *op++ = offset >> 8;
+  size_t extra = match_len - LZ_MIN_MATCH;
+  *token |= extra < 15 ? extra : 15;
+  if (extra >= 15)
+  {
+    op = lz_put_length (op, extra - 15);
+  }
+  return op;
+}
+
+/* Compress the page at SRC into at most DST_SIZE bytes at DST.
+   Returns the compressed size, or 0 if it does not fit. */
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_size)
+{
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  const uint8_t *end = src + PGSIZE;
+  uint8_t *op = dst;
+  uint8_t *op_end = dst + dst_size;
+
+  memset (lz_hash_table, 0, sizeof lz_hash_table);
+  while (ip + LZ_MIN_MATCH <= end)
+  {
+    uint32_t seq = lz_read32 (ip);
+    uint16_t *bucket = &lz_hash_table[lz_hash (seq)];
+    const uint8_t *ref = src + *bucket;
+    *bucket = ip - src;
+
+    if (ref < ip && lz_read32 (ref) == seq)
+    {
+      size_t len = LZ_MIN_MATCH;
+      while (ip + len < end && ref[len] == ip[len])
+      {
+        len++;
+      }
+
+      op = lz_emit (op, op_end, anchor, ip - anchor, ip - ref, len);
+      if (op == NULL)
+      {
+        return 0;
+      }
+      ip += len;
+      anchor = ip;
+    }
+    else
+    {
+      ip++;
+    }
+  }
+
+  op = lz_emit (op, op_end, anchor, end - anchor, 0, 0);
+  return op != NULL ? (size_t) (op - dst) : 0;
+}
+
+/* Decompress SRC_SIZE bytes at SRC into the page at DST.
+   Returns false if the stream is malformed. */
+static bool lz_decompress (const uint8_t *src, size_t src_size, uint8_t *dst)
+{
+  const uint8_t *ip = src;
+  const uint8_t *ip_end = src + src_size;
+  uint8_t *op = dst;
+  uint8_t *op_end = dst + PGSIZE;
+
+  while (op < op_end)
+  {
+    if (ip >= ip_end)
+    {
+      return false;
+    }
+    uint8_t token = *ip++;
+
+    size_t lit_len = token >> 4;
+    if (lit_len == 15 && !lz_get_length (&ip, ip_end, &lit_len))
+    {
+      return false;
+    }
+    if (lit_len > (size_t) (ip_end - ip) || lit_len > (size_t) (op_end - op))
+    {
+      return false;
+    }
+    memcpy (op, ip, lit_len);
+    op += lit_len;
+    ip += lit_len;
+    if (op == op_end)
+    {
+      break;
+    }
+
+    if (ip_end - ip < 2)
+    {
+      return false;
+    }
+    size_t offset = ip[0] | ip[1] << 8;
+    ip += 2;
+
+    size_t match_len = token & 0x0f;
+    if (match_len == 15 && !lz_get_length (&ip, ip_end, &match_len))
+    {
+      return false;
+    }
+    match_len += LZ_MIN_MATCH;
+    if (offset == 0 || offset > (size_t) (op - dst) || match_len > (size_t) (op_end - op))
+    {
+      return false;
+    }
+
+    // Byte by byte, since the match may overlap the bytes it produces
+    const uint8_t *ref = op - offset;
+    while (match_len-- > 0)
+    {
+      *op++ = *ref++;
+    }
+  }
+  return true;
+}
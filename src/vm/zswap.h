@@ -0,0 +1,14 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+void zswap_init (size_t page_limit);
+bool zswap_store (const void *page, uint32_t *slot);
+void zswap_load (uint32_t slot, void *page);
+void zswap_free (uint32_t slot);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */